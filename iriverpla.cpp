@@ -1,9 +1,14 @@
 #include "iriverpla.h"
 #include "ui_iriverpla.h"
 #include "plafile.h"
+#include "plaplaylistmodel.h"
+#include "plasearchproxy.h"
+#include "plasession.h"
 
 #include <QtGui>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
 
 IRiverPla::IRiverPla(QWidget *parent) :
     QMainWindow(parent),
@@ -13,8 +18,22 @@ IRiverPla::IRiverPla(QWidget *parent) :
     // announce that this application (in general) accept drops even though they are only added to listwidget
     setAcceptDrops(true);
     playList = new plaPlayList(this);
-    playList->preserveSongFolder = ui->cbKeepFolder->isChecked();
+    bool restored = restoreSession();
+    playlistModel = new plaPlaylistModel(playList->pathStore(), this);
+    playlistModel->setHandles(playList->handles());
+    playlistModel->markDuplicates(playList->duplicates());
+    searchProxy = new plaSearchProxy(this);
+    searchProxy->setPlaylistModel(playlistModel);
+    ui->lstFiles->setModel(searchProxy);
+    if (restored)
+        ui->cbKeepFolder->setChecked(playList->preserveSongFolder);
+    else
+        playList->preserveSongFolder = ui->cbKeepFolder->isChecked();
     ui->edtPlaylistName->setText(playList->playlistName);
+    ui->cmbPlayer->blockSignals(true);
+    ui->cmbPlayer->addItems(plaProfiles::names());
+    ui->cmbPlayer->setCurrentIndex(playList->deviceProfile);
+    ui->cmbPlayer->blockSignals(false);
     ui->edtLog->hide();
     connect(playList, SIGNAL(OnError(QString,QString,QString)), this, SLOT(playListError(QString,QString,QString)));
     connect(playList, SIGNAL(OnReady()), this, SLOT(playListReady()));
@@ -22,6 +41,7 @@ IRiverPla::IRiverPla(QWidget *parent) :
 
 IRiverPla::~IRiverPla()
 {
+    saveSession();
     delete playList;
     delete ui;
 }
@@ -92,27 +112,36 @@ void IRiverPla::on_action_Add_to_playlist_triggered()
 void IRiverPla::on_actionRemove_triggered()
 {
     qDebug() << "IRiverPla::on_actionRemove_triggered()";
-    QList<QListWidgetItem*> selectedItems = ui->lstFiles->selectedItems();
-    for (int i=0; i<selectedItems.count(); i++) {
-        delete ui->lstFiles->item(ui->lstFiles->row(selectedItems.at(i)));
-    }
-    QStringList remainingFiles;
-    for (int i = 0; i < ui->lstFiles->count(); i++) {
-        remainingFiles.append(ui->lstFiles->item(i)->text());
-    }
-    playList->setFiles(remainingFiles);
+    playlistModel->removeFileRows(selectedRows());
+    playList->setHandles(playlistModel->handles());
 }
 void IRiverPla::on_actionGenerate_triggered()
 {
     qDebug() << "IRiverPla::on_actionGenerate_triggered()";
     try {
         playList->playlistName = ui->edtPlaylistName->text();
+        if (playList->musicFileDestination.isEmpty())
+            on_actionMusic_destination_triggered();
+        if (playList->musicFileDestination.isEmpty()) {
+            ui->edtLog->append("Music destination is not set, playlist was not generated");
+            return;
+        }
         playList->doWork();
     }
     catch (...) {
         qDebug() << "Playlist generation failed";
     }
 }
+void IRiverPla::on_actionSort_by_folder_triggered()
+{
+    qDebug() << "IRiverPla::on_actionSort_by_folder_triggered()";
+    sortPlaylist(QList<plaSorter::Key>() << plaSorter::KeyFolder << plaSorter::KeyFileName);
+}
+void IRiverPla::on_actionSort_by_file_name_triggered()
+{
+    qDebug() << "IRiverPla::on_actionSort_by_file_name_triggered()";
+    sortPlaylist(QList<plaSorter::Key>() << plaSorter::KeyFileName << plaSorter::KeyFolder);
+}
 void IRiverPla::on_actionShow_Log_triggered()
 {
     qDebug() << "IRiverPla::on_actionShow_Log_triggered()";
@@ -152,6 +181,13 @@ void IRiverPla::on_btnDown_clicked() {
 void IRiverPla::on_cbKeepFolder_toggled(bool checked) {
     playList->preserveSongFolder = checked;
 }
+void IRiverPla::on_cmbPlayer_currentIndexChanged(int index) {
+    if (index >= 0)
+        playList->deviceProfile = index;
+}
+void IRiverPla::on_edtSearch_textChanged(QString text) {
+    searchProxy->setSearchText(text);
+}
 void IRiverPla::on_btnRemove_clicked() {
     on_actionRemove_triggered();
 }
@@ -169,7 +205,6 @@ void IRiverPla::dropEvent(QDropEvent *event) {
             addFilesToPlaylist(droppedFiles);
         }
         event->acceptProposedAction();
-        ui->lstFiles->dropEvent(event);
     }
 }
 void IRiverPla::dragEnterEvent(QDragEnterEvent *event) {
@@ -204,17 +239,43 @@ void IRiverPla::addFilesToPlaylist(QStringList files)
 {
     try
     {
-        QStringList uniqueFiles;
+        QVector<plaPathStore::Handle> uniqueFiles;
+        QSet<plaPathStore::Handle> received;
         // File type check -> unsynch situation with list of files in GUI vs playList object
         files = playList->filterSupportedFiles(files);
         for (int i=0; i<files.count(); i++) {
-            if (ui->lstFiles->findItems(files.at(i), Qt::MatchExactly).count()!=0)
+            plaPathStore::Handle handle = playList->pathStore()->intern(files.at(i));
+            if (playlistModel->contains(handle) || received.contains(handle))
                 continue;
-            uniqueFiles.append(files.at(i));
+            received.insert(handle);
+            uniqueFiles.append(handle);
+        }
+        // Same files through another path are dropped, songs with same content are added but marked
+        QVector<plaPathStore::Handle> sameFiles;
+        QHash<plaPathStore::Handle, plaPathStore::Handle> duplicates = playList->checkDuplicates(uniqueFiles, &sameFiles);
+        if (!sameFiles.isEmpty()) {
+            QSet<plaPathStore::Handle> skipped;
+            foreach (plaPathStore::Handle handle, sameFiles) {
+                skipped.insert(handle);
+                ui->edtLog->append(QString("Already in playlist through another path: %1").arg(playList->pathStore()->path(handle)));
+            }
+            QVector<plaPathStore::Handle> accepted;
+            foreach (plaPathStore::Handle handle, uniqueFiles) {
+                if (!skipped.contains(handle))
+                    accepted.append(handle);
+            }
+            uniqueFiles = accepted;
         }
         ui->edtLog->append(QString("Files received: %1\r\n").arg(uniqueFiles.size()));
-        ui->lstFiles->addItems(uniqueFiles);
-        playList->addFiles(uniqueFiles);
+        playlistModel->addHandles(uniqueFiles);
+        playlistModel->markDuplicates(duplicates);
+        playList->addHandles(uniqueFiles);
+        if (!duplicates.isEmpty()) {
+            qint64 wasted = 0;
+            foreach (plaPathStore::Handle handle, duplicates.keys())
+                wasted += playList->songInfo(handle).size;
+            ui->edtLog->append(QString("Duplicate songs: %1 (%2 MB), marked in playlist").arg(duplicates.count()).arg(wasted / (1024 * 1024)));
+        }
         ui->edtLog->append(playList->getPLAAsString());
     }
     catch (...) {
@@ -222,73 +283,102 @@ void IRiverPla::addFilesToPlaylist(QStringList files)
     }
 }
 /**
- * In this version we take away all items from list and sort them as we wish and then insert them back to list.
- * In next version we should create a model that takes care of sorting and then use normal listview component to show model.
+ * @brief Restores previous session snapshot to playList, only settings, paths and playlist order are read here,
+ * cached song metadata is read from snapshot later when needed.
+ * @return true if session was restored, false if there was no (valid) snapshot
+ */
+bool IRiverPla::restoreSession()
+{
+    QElapsedTimer timer;
+    timer.start();
+    plaSession *session = new plaSession;
+    if (session->open(plaSession::defaultFileName()) && session->restore(playList)) {
+        ui->edtLog->append(QString("Session restored: %1 files in %2 ms").arg(playList->playlistFileAmount()).arg(timer.elapsed()));
+        return true;
+    }
+    delete session;
+    return false;
+}
+/**
+ * @brief Saves current session snapshot, called when program is closed.
+ */
+void IRiverPla::saveSession()
+{
+    playList->playlistName = ui->edtPlaylistName->text();
+    if (!plaSession::save(plaSession::defaultFileName(), playList))
+        qDebug() << "Session could not be saved to " << plaSession::defaultFileName();
+}
+/**
+ * @brief Used to get selected rows of playlist model (not of the filtered view) in ascending order.
+ */
+QList<int> IRiverPla::selectedRows()
+{
+    QList<int> rows;
+    foreach (const QModelIndex &index, ui->lstFiles->selectionModel()->selectedIndexes())
+        rows.append(searchProxy->mapToSource(index).row());
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+/**
+ * @brief Sorts whole playlist (also rows hidden by search) and applies the new order to model in one operation.
+ * @param keys Sort keys in priority order
+ */
+void IRiverPla::sortPlaylist(QList<plaSorter::Key> keys)
+{
+    try {
+        QElapsedTimer timer;
+        timer.start();
+        plaSorter sorter(playList->pathStore());
+        playlistModel->reorder(sorter.sort(playlistModel->handles(), keys));
+        playList->setHandles(playlistModel->handles());
+        ui->edtLog->append(QString("Sorted %1 files in %2 ms").arg(playlistModel->rowCount()).arg(timer.elapsed()));
+    }
+    catch (...) {
+        ui->edtLog->append("Error - IRiverPla::sortPlaylist");
+    }
+}
+/**
+ * Selected rows are moved one step and the new order is given to the model as one reorder operation,
+ * selection follows moved items so they can be moved again.
  * Algorithm:
- * - Loop through each 'selected item' one by one and
+ * - Loop through each 'selected row' one by one and
  * - put it to correct position in list
- * 3rd temporary list is used as a storage for final positions. It is initially filled with listbox content.
- * Looks like that selected items are in the order that they have been selected, so we have to reorganize them
- * to be in the same order that they exist in list.
+ * 3rd temporary list is used as a storage for final positions. It is initially filled with current row numbers.
+ * Selected rows are handled in the order that they exist in list.
  *
  * Here Qt::AscendingOrder means that an item should bubble to top direction (towards item at 0, top of list)
  * Here Qt::DescendingOrder means that an item should be pushed downwards (towards item at count(), end of list)
+ *
+ * When view is filtered with search text, items are moved past hidden items one at a time.
  */
 void IRiverPla::repositionItems(Qt::SortOrder direction)
 {
     try {
-        // Here we do not actually care about selected items row position in list...we assume each string is unique in list
-        QList<QListWidgetItem*> selectedItems = ui->lstFiles->selectedItems();
-        if (0 == selectedItems.count())
+        QList<int> rowsToMove = selectedRows();
+        if (rowsToMove.isEmpty())
             return;
-        QMap<int, QString> tmp;
-        for (int i=0; i<selectedItems.count(); i++) {
-            tmp[ui->lstFiles->row(selectedItems.at(i))] = selectedItems.at(i)->text();
-        }
-        QStringList itemsToMove;
-        QMap<int,QString>::const_iterator it = tmp.constBegin();
-        qDebug() << "Items to move:";
-        while (it != tmp.constEnd()) {
-            qDebug() << " row " << it.key() << " value " << it.value();
-             itemsToMove.append(it.value());
-             ++it;
-         }
-        //qDebug() << "SortOrder " << direction << ": " << "Selected count " << itemsToMove.count() << "; List count " << ui->lstFiles->count();
-        QStringList new_order;
-        for (int i=0; i<ui->lstFiles->count(); i++) {
-            new_order.append(ui->lstFiles->item(i)->text());
-        }
+        qDebug() << "Rows to move:" << rowsToMove;
+        QVector<int> new_order(playlistModel->rowCount());
+        for (int i=0; i<new_order.count(); i++)
+            new_order[i] = i;
         if (direction == Qt::AscendingOrder) {
-            for (int i=0; i<itemsToMove.count(); i++) {
-                for (int j=0; j<new_order.count(); j++) {
-                    if (itemsToMove[i] == new_order[j]) {
-                        // bubble upwards item to correct place by swapping positions...
-                        if (j==0) break; // beginning of list, no need to reposition...
-                        qDebug() << " swap " << new_order[j] << " <-> " << new_order[j-1];
-                        new_order.swap(j, j-1);
-                        break; // go to next selected item...
-                    }
-                }
+            for (int i=0; i<rowsToMove.count(); i++) {
+                // bubble upwards item to correct place by swapping positions...
+                int j = new_order.indexOf(rowsToMove.at(i));
+                if (j<=0) continue; // beginning of list, no need to reposition...
+                qSwap(new_order[j], new_order[j-1]);
             }
         }
         else { //direction == Qt::DescendingOrder
-            for (int i=itemsToMove.count()-1; i>=0; i--) {
-                for (int j=new_order.count()-1; j>=0; j--) {
-                    if (itemsToMove[i] == new_order[j]) {
-                        // bubble item down to correct place by swapping positions...
-                        if (j==new_order.count()-1) break; // last, no need to reposition...
-                        qDebug() << " swap " << new_order[j] << " <-> " << new_order[j+1];
-                        new_order.swap(j, j+1);
-                        break;
-                    }
-                }
+            for (int i=rowsToMove.count()-1; i>=0; i--) {
+                // bubble item down to correct place by swapping positions...
+                int j = new_order.lastIndexOf(rowsToMove.at(i));
+                if (j<0 || j==new_order.count()-1) continue; // last, no need to reposition...
+                qSwap(new_order[j], new_order[j+1]);
             }
         }
-        ui->lstFiles->clear();
-        //qDebug() << "Sorted list count " << new_order.count();
-        ui->lstFiles->addItems(new_order);
-        playList->setFiles(new_order);
-        //qDebug() << "Sorted, adding items again to list, list count " << ui->lstFiles->count();
+        playlistModel->reorder(new_order);
+        playList->setHandles(playlistModel->handles());
         qDebug() << "Done...";
     }
     catch (...) {
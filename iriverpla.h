@@ -2,7 +2,10 @@
 #define IRIVERPLA_H
 
 #include <QMainWindow>
+#include "plasorter.h"
 class plaPlayList;
+class plaPlaylistModel;
+class plaSearchProxy;
 
 namespace Ui {
     class IRiverPla;
@@ -13,11 +16,14 @@ namespace Ui {
  *
  * Currently available services:
  * \li selecting tracks
- * \li ordering selected tracks
+ * \li ordering selected tracks, sorting whole playlist by folder and file name
+ * \li searching tracks, playlist view is filtered as search text is typed
  * \li log output for debug purposes (CTRL+L)
  * \li 'settings', music files destination, root under which all music files exists, playlist destination,...
  * \li creating PLA file and copying it to destination
  * \li drop support for adding files (checks playlist file type support)
+ * \li duplicate detection when files are added (same file through other path is skipped, same content is marked)
+ * \li session (playlist, settings and cached file information) is saved on exit and restored on startup
  *
  * Two classes to work with:
  * \li IRiverPLA, very thin GUI class to offer interaction with user (should be easily replacable for ex. with QML?)
@@ -43,6 +49,8 @@ private slots:
     void on_actionMusic_destination_triggered();
     void on_actionRemove_triggered();
     void on_actionGenerate_triggered();
+    void on_actionSort_by_folder_triggered();
+    void on_actionSort_by_file_name_triggered();
     void on_btnAdd_clicked();
     void on_btnDestination_clicked();
     void on_btnGenerate_clicked();
@@ -51,6 +59,8 @@ private slots:
     void on_btnPlaylistdestination_clicked();
     void on_btnRemove_clicked();
     void on_cbKeepFolder_toggled(bool checked);
+    void on_cmbPlayer_currentIndexChanged(int index);
+    void on_edtSearch_textChanged(QString text);
     void repositionItems(Qt::SortOrder);
     void playListError(QString, QString, QString);
     void addFilesToPlaylist(QStringList files);
@@ -64,6 +74,13 @@ private:
     QString previousAddMusicPath;
     Ui::IRiverPla *ui;
     plaPlayList *playList;
+    plaPlaylistModel *playlistModel;
+    plaSearchProxy *searchProxy;
+
+    QList<int> selectedRows();
+    bool restoreSession();
+    void saveSession();
+    void sortPlaylist(QList<plaSorter::Key> keys);
 };
 
 #endif // IRIVERPLA_H
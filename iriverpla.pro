@@ -6,7 +6,7 @@
 
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = iriverpla
 TEMPLATE = app
@@ -14,10 +14,28 @@ TEMPLATE = app
 
 SOURCES += main.cpp\
         iriverpla.cpp \
-    plafile.cpp
+    plafile.cpp \
+    placopyscheduler.cpp \
+    pladuplicatedetector.cpp \
+    plapathstore.cpp \
+    plaplaylistmodel.cpp \
+    plasearchindex.cpp \
+    plasearchproxy.cpp \
+    plasession.cpp \
+    plasorter.cpp
 
 HEADERS  += iriverpla.h \
-    plafile.h
+    plafile.h \
+    placopyscheduler.h \
+    pladuplicatedetector.h \
+    plaprofile.h \
+    plapathstore.h \
+    plaplaylistmodel.h \
+    plasearchindex.h \
+    plasearchproxy.h \
+    plasession.h \
+    plasonginfo.h \
+    plasorter.h
 
 FORMS    += iriverpla.ui
 
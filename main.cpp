@@ -12,10 +12,10 @@
  * \li done except folder selection missing: file selection in multiple ways (one/many selection (extended), drag and drop, folder selection)
  * \li done except ordering by dragging missing: define order of selected files (dragging, ordering button)
  * \li done: item(s) removal from selected list via button
+ * \li done: selected file(s) copying to device if they are not there already (plaCopyScheduler)
  *
  * still needs implementation
  * \li selected file(s) existence and capacity check from iRiver device
- * \li selected file(s) copying to device if they are not there already
  * \li (?) settings to support backround threading (start synchronizing immediately when you know what and where)
  * \li some dynamic reporting that would show destination free capacity if all selections are synchronized
  *
@@ -32,6 +32,7 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    a.setApplicationName("iriverpla");   // session snapshot location depends on this
     IRiverPla w;
     w.show();
     return a.exec();
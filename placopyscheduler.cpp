@@ -0,0 +1,227 @@
+#include "placopyscheduler.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * Ordering of transfers inside one destination directory: by source device and location on it.
+ * Path is used as a tie breaker so that order is stable also where inode numbers are not available.
+ */
+bool plaCopyScheduler::sourceLocationLessThan(const Transfer &a, const Transfer &b)
+{
+    if (a.device != b.device)
+        return a.device < b.device;
+    if (a.location != b.location)
+        return a.location < b.location;
+    return a.source < b.source;
+}
+/**
+ * Ordering of destination directories: the batch whose first read is earliest on source disk is copied first.
+ */
+bool plaCopyScheduler::batchLocationLessThan(const DirectoryBatch &a, const DirectoryBatch &b)
+{
+    return sourceLocationLessThan(a.transfers.first(), b.transfers.first());
+}
+
+
+plaCopyScheduler::plaCopyScheduler(QObject *parent) :
+    QObject(parent)
+{
+}
+/**
+ * @brief Adds one file to be copied, nothing is copied before run() is called.
+ * @param source Full path of the source file
+ * @param destination Full path of the destination file (directories are created if missing)
+ * @return true if transfer was added, false if another source is already copied to the same destination
+ */
+bool plaCopyScheduler::addTransfer(QString source, QString destination)
+{
+    const QString key = destination.toCaseFolded();
+    QHash<QString, QString>::const_iterator it = m_destinations.constFind(key);
+    if (it != m_destinations.constEnd()) {
+        errorSignaling("ERROR", QString("Songs '%1' and '%2' would both be copied to '%3'").arg(it.value()).arg(source).arg(destination));
+        return false;
+    }
+    m_destinations.insert(key, source);
+    Transfer transfer;
+    transfer.source = source;
+    transfer.destination = destination;
+    transfer.size = 0;
+    transfer.device = 0;
+    transfer.location = 0;
+#ifdef Q_OS_UNIX
+    struct stat info;
+    if (::stat(QFile::encodeName(source).constData(), &info) == 0) {
+        transfer.size = info.st_size;
+        transfer.device = info.st_dev;
+        transfer.location = info.st_ino;
+    }
+#else
+    transfer.size = QFileInfo(source).size();
+#endif
+    m_transfers.append(transfer);
+    return true;
+}
+void plaCopyScheduler::clear()
+{
+    m_transfers.clear();
+    m_destinations.clear();
+}
+int plaCopyScheduler::transferCount() const
+{
+    return m_transfers.count();
+}
+/**
+ * @brief Used to get the amount of bytes that will be written to destination.
+ */
+qint64 plaCopyScheduler::totalBytes() const
+{
+    qint64 retVal = 0;
+    foreach (const Transfer &transfer, m_transfers)
+        retVal += transfer.size;
+    return retVal;
+}
+/**
+ * @brief Groups transfers by destination directory and orders them by source location.
+ * @return Directory batches in the order they should be written
+ */
+QList<plaCopyScheduler::DirectoryBatch> plaCopyScheduler::schedule() const
+{
+    QMap<QString, DirectoryBatch> batches;
+    foreach (const Transfer &transfer, m_transfers) {
+        QString directory = QFileInfo(transfer.destination).absolutePath();
+        DirectoryBatch &batch = batches[directory];
+        batch.directory = directory;
+        batch.transfers.append(transfer);
+    }
+    QList<DirectoryBatch> retVal = batches.values();
+    for (int i = 0; i < retVal.count(); i++)
+        std::stable_sort(retVal[i].transfers.begin(), retVal[i].transfers.end(), sourceLocationLessThan);
+    std::stable_sort(retVal.begin(), retVal.end(), batchLocationLessThan);
+    return retVal;
+}
+/**
+ * @brief Copies all added transfers to their destinations, one destination directory at a time.
+ * Scheduler is cleared after run, whether it succeeded or not.
+ * @return true if all files were copied, false if some copy failed (copying stops at first failure)
+ */
+bool plaCopyScheduler::run()
+{
+    QList<DirectoryBatch> batches = schedule();
+    clear();
+    foreach (const DirectoryBatch &batch, batches) {
+        qDebug() << "plaCopyScheduler::run - directory " << batch.directory << ", files " << batch.transfers.count();
+        if (!QDir().mkpath(batch.directory)) {
+            errorSignaling("ERROR", QString("Destination directory '%1' could not be created").arg(batch.directory));
+            return false;
+        }
+        foreach (const Transfer &transfer, batch.transfers) {
+            if (!copyFile(transfer)) {
+                flushDirectory(batch.directory);
+                return false;
+            }
+        }
+        flushDirectory(batch.directory);
+    }
+    return true;
+}
+/**
+ * @brief Copies one file, destination is preallocated before any data is written to it.
+ * Data is not synchronized here, that is done once per directory in flushDirectory().
+ */
+bool plaCopyScheduler::copyFile(const Transfer &transfer)
+{
+    const qint64 blockSize = 1024 * 1024;
+    QFile in(transfer.source);
+    if (!in.open(QIODevice::ReadOnly)) {
+        errorSignaling("ERROR", QString("Song '%1' could not be opened for reading").arg(transfer.source));
+        return false;
+    }
+    QFile out(transfer.destination);
+    if (!out.open(QIODevice::Truncate | QIODevice::WriteOnly)) {
+        errorSignaling("ERROR", QString("Destination '%1' could not be opened for writing").arg(transfer.destination));
+        return false;
+    }
+    if (!preallocate(out, transfer.size))
+        qDebug() << "plaCopyScheduler::copyFile - preallocation failed for " << transfer.destination;
+    QByteArray buffer;
+    while (!in.atEnd()) {
+        buffer = in.read(blockSize);
+        if (buffer.isEmpty() && in.error() != QFile::NoError)
+            break;
+        if (out.write(buffer) != buffer.size()) {
+            errorSignaling("ERROR", QString("Writing '%1' failed: %2").arg(transfer.destination).arg(out.errorString()));
+            out.close();
+            out.remove();
+            return false;
+        }
+    }
+    if (in.error() != QFile::NoError) {
+        errorSignaling("ERROR", QString("Reading '%1' failed: %2").arg(transfer.source).arg(in.errorString()));
+        out.close();
+        out.remove();
+        return false;
+    }
+    out.close();
+    OnFileCopied(QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss.zzz"), "INFO", transfer.destination);
+    return true;
+}
+/**
+ * @brief Reserves space for whole file at once so that file system can allocate contiguous clusters.
+ * Clusters are only reserved, file size is not changed: extending the file (posix_fallocate mode 0 or
+ * resize) makes vfat write zeros over the whole file before the real data is written. Where reserving
+ * is not supported the file is not preallocated at all.
+ * @return true if space was reserved, false if file is written without preallocation
+ */
+bool plaCopyScheduler::preallocate(QFile &file, qint64 size)
+{
+    if (size <= 0)
+        return true;
+#ifdef Q_OS_LINUX
+    return ::fallocate(file.handle(), FALLOC_FL_KEEP_SIZE, 0, size) == 0;
+#else
+    Q_UNUSED(file);
+    return false;
+#endif
+}
+/**
+ * @brief Writes cached data and metadata of the whole directory batch to the device with one flush.
+ */
+void plaCopyScheduler::flushDirectory(const QString &directory)
+{
+#ifdef Q_OS_UNIX
+    int fd = ::open(QFile::encodeName(directory).constData(), O_RDONLY);
+    if (fd < 0) {
+        ::sync();
+        return;
+    }
+#ifdef Q_OS_LINUX
+    // syncfs flushes the file data of the batch as well as the directory entries
+    ::syncfs(fd);
+#else
+    ::sync();
+#endif
+    ::fsync(fd);
+    ::close(fd);
+#else
+    Q_UNUSED(directory);
+#endif
+}
+/**
+ * @brief Wrapper method for sending OnError event
+ */
+void plaCopyScheduler::errorSignaling(QString category, QString message)
+{
+    OnError(QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss.zzz"), category, message);
+}
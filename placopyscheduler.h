@@ -0,0 +1,70 @@
+#ifndef PLACOPYSCHEDULER_H
+#define PLACOPYSCHEDULER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class QFile;
+
+/**
+ * \brief plaCopyScheduler decides in which order music files are written to the player and writes them.
+ *
+ * Copying files in playlist order interleaves destination directories, which makes FAT rewrite its
+ * allocation table and directory entries constantly. Slow USB flash suffers most from that, so scheduler:
+ * \li groups transfers by destination directory, one directory is completed before the next one is started
+ * \li orders reads inside a group by source location (inode order) so source disk is read mostly sequentially
+ * \li reserves clusters for each destination file before writing (without zero filling), so clusters end up contiguous
+ * \li flushes data and metadata once per destination directory instead of once per file
+ *
+ * Usage: add all transfers with addTransfer() and call run(). Two sources are never written to the same
+ * destination, addTransfer() refuses the second one. Progress and errors are reported with signals
+ * that have the same signature as in plaPlayList so they can be forwarded as such.
+ */
+class plaCopyScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit plaCopyScheduler(QObject *parent = 0);
+
+    bool addTransfer(QString source, QString destination);
+    void clear();
+    int transferCount() const;
+    qint64 totalBytes() const;
+
+    bool run();
+
+signals:
+    void OnError(QString time, QString category, QString message);          /**< Notifies errors that has happened */
+    void OnFileCopied(QString time, QString category, QString fileName);    /**< Notifies a successfull file copy to destination */
+
+private:
+    /** One file copy from source to destination. */
+    struct Transfer {
+        QString source;
+        QString destination;
+        qint64 size;
+        quint64 device;     /**< source device, transfers from same device are ordered by location */
+        quint64 location;   /**< source inode number (or 0 if not available on this platform) */
+    };
+    /** All transfers that are written to the same destination directory. */
+    struct DirectoryBatch {
+        QString directory;
+        QList<Transfer> transfers;
+    };
+
+    QList<Transfer> m_transfers;
+    QHash<QString, QString> m_destinations;     /**< source by case folded destination, FAT names are case insensitive */
+
+    QList<DirectoryBatch> schedule() const;
+    bool copyFile(const Transfer &transfer);
+    bool preallocate(QFile &file, qint64 size);
+    void flushDirectory(const QString &directory);
+    void errorSignaling(QString category, QString message);
+
+    static bool sourceLocationLessThan(const Transfer &a, const Transfer &b);
+    static bool batchLocationLessThan(const DirectoryBatch &a, const DirectoryBatch &b);
+};
+
+#endif // PLACOPYSCHEDULER_H
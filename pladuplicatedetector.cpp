@@ -0,0 +1,240 @@
+#include "pladuplicatedetector.h"
+#include "plafile.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QStringList>
+#include <QtConcurrentMap>
+
+static const qint64 hashBlockSize = 64 * 1024;     /**< bytes hashed from both head and tail of file */
+
+
+plaDuplicateDetector::plaDuplicateDetector(plaPlayList *playList) :
+    m_playList(playList)
+{
+}
+/**
+ * @brief Checks songs that are about to be added to playlist, candidates that are not same files are
+ * registered as playlist members (caller is expected to add them).
+ * @param candidates Songs to be added, exact duplicates should already be filtered out
+ * @param sameFiles Candidates that are the same file as some playlist song or earlier candidate
+ * @return Candidates whose content equals some playlist song or earlier candidate, mapped to that song
+ */
+QHash<plaPathStore::Handle, plaPathStore::Handle> plaDuplicateDetector::check(const QVector<plaPathStore::Handle> &candidates,
+                                                                              QVector<plaPathStore::Handle> *sameFiles)
+{
+    QHash<plaPathStore::Handle, plaPathStore::Handle> retVal;
+    m_verified.clear();
+    registerPending();
+
+    // 1. same file and 2. size buckets
+    QVector<plaPathStore::Handle> collided;
+    QSet<plaPathStore::Handle> added;
+    QSet<plaPathStore::Handle> toHash;
+    foreach (plaPathStore::Handle handle, candidates) {
+        if (m_members.contains(handle))
+            continue;
+        const plaSongInfo info = m_playList->verifiedSongInfo(handle);
+        m_verified.insert(handle);
+        if (sameFileRegistered(info)) {
+            sameFiles->append(handle);
+            continue;
+        }
+        foreach (plaPathStore::Handle other, m_bySize.value(info.size))
+            verifyMember(other);
+        registerSong(handle, info);
+        m_members.insert(handle);
+        added.insert(handle);
+        const QVector<plaPathStore::Handle> &bucket = m_bySize[info.size];
+        if (bucket.count() < 2)
+            continue;
+        collided.append(handle);
+        foreach (plaPathStore::Handle other, bucket) {
+            if (!m_hashes.contains(other))
+                toHash.insert(other);
+        }
+    }
+
+    // 3. content of colliding songs, compared to all other members of the bucket except candidates added
+    // after them (those are compared to this one instead). Member that was registered again after its file
+    // changed may be after the candidate in bucket.
+    computeHashes(toHash);
+    foreach (plaPathStore::Handle handle, collided) {
+        const QByteArray hash = m_hashes.value(handle);
+        if (hash.isEmpty())
+            continue;
+        bool before = true;
+        foreach (plaPathStore::Handle other, m_bySize.value(m_registered.value(handle).size)) {
+            if (other == handle) {
+                before = false;
+                continue;
+            }
+            if (!before && added.contains(other))
+                continue;
+            if (m_hashes.value(other) == hash) {
+                retVal.insert(handle, other);
+                break;
+            }
+        }
+    }
+    return retVal;
+}
+/**
+ * @brief Replaces playlist membership, removed songs are forgotten and new ones are registered on next check().
+ */
+void plaDuplicateDetector::setMembers(const QVector<plaPathStore::Handle> &handles)
+{
+    QSet<plaPathStore::Handle> members;
+    members.reserve(handles.count());
+    foreach (plaPathStore::Handle handle, handles) {
+        members.insert(handle);
+        if (!m_members.contains(handle))
+            m_pending.append(handle);
+    }
+    foreach (plaPathStore::Handle handle, m_members) {
+        if (!members.contains(handle))
+            unregisterSong(handle);
+    }
+    m_members = members;
+}
+/**
+ * @brief Adds songs to playlist membership, songs that were not checked are registered on next check().
+ */
+void plaDuplicateDetector::addMembers(const QVector<plaPathStore::Handle> &handles)
+{
+    foreach (plaPathStore::Handle handle, handles) {
+        if (m_members.contains(handle))
+            continue;
+        m_members.insert(handle);
+        m_pending.append(handle);
+    }
+}
+void plaDuplicateDetector::clear()
+{
+    m_members.clear();
+    m_pending.clear();
+    m_registered.clear();
+    m_verified.clear();
+    m_hashes.clear();
+    m_byCanonical.clear();
+    m_byFileId.clear();
+    m_bySize.clear();
+}
+/**
+ * Registered song that is the same file is verified first: a member whose file has changed since it was
+ * registered is registered again with current metadata, and it is the same file only if it still matches.
+ */
+bool plaDuplicateDetector::sameFileRegistered(const plaSongInfo &info)
+{
+    if (m_byCanonical.contains(info.canonical)) {
+        verifyMember(m_byCanonical.value(info.canonical));
+        if (m_byCanonical.contains(info.canonical))
+            return true;
+    }
+    const FileId fileId(info.device, info.inode);
+    if (fileId == FileId(0, 0) || !m_byFileId.contains(fileId))
+        return false;
+    verifyMember(m_byFileId.value(fileId));
+    return m_byFileId.contains(fileId);
+}
+/**
+ * @brief Compares registered metadata of a member with its file, at most once per check().
+ * Member whose file has changed is registered again with current metadata.
+ */
+void plaDuplicateDetector::verifyMember(plaPathStore::Handle handle)
+{
+    if (m_verified.contains(handle) || !m_registered.contains(handle))
+        return;
+    m_verified.insert(handle);
+    const plaSongInfo info = m_playList->verifiedSongInfo(handle);
+    const plaSongInfo &registered = m_registered[handle];
+    if (registered.size == info.size && registered.modified == info.modified && registered.device == info.device
+     && registered.inode == info.inode && registered.canonical == info.canonical)
+        return;
+    unregisterSong(handle);
+    registerSong(handle, info);
+}
+void plaDuplicateDetector::registerSong(plaPathStore::Handle handle, const plaSongInfo &info)
+{
+    m_registered.insert(handle, info);
+    if (!m_byCanonical.contains(info.canonical))
+        m_byCanonical.insert(info.canonical, handle);
+    const FileId fileId(info.device, info.inode);
+    if (fileId != FileId(0, 0) && !m_byFileId.contains(fileId))
+        m_byFileId.insert(fileId, handle);
+    QVector<plaPathStore::Handle> &bucket = m_bySize[info.size];
+    if (!bucket.contains(handle))
+        bucket.append(handle);
+}
+void plaDuplicateDetector::unregisterSong(plaPathStore::Handle handle)
+{
+    QHash<plaPathStore::Handle, plaSongInfo>::iterator info = m_registered.find(handle);
+    if (info == m_registered.end())
+        return;     // never registered
+    if (m_byCanonical.value(info->canonical) == handle)
+        m_byCanonical.remove(info->canonical);
+    const FileId fileId(info->device, info->inode);
+    if (m_byFileId.value(fileId) == handle)
+        m_byFileId.remove(fileId);
+    QHash<qint64, QVector<plaPathStore::Handle> >::iterator bucket = m_bySize.find(info->size);
+    m_registered.erase(info);
+    m_hashes.remove(handle);
+    if (bucket == m_bySize.end())
+        return;
+    int pos = bucket->indexOf(handle);
+    if (pos >= 0)
+        bucket->remove(pos);
+    if (bucket->isEmpty())
+        m_bySize.erase(bucket);
+}
+/**
+ * @brief Registers playlist songs that were added without check(), in playlist order.
+ * Cached metadata is used as such (restored songs need no file system access), it is verified on collision.
+ */
+void plaDuplicateDetector::registerPending()
+{
+    foreach (plaPathStore::Handle handle, m_pending) {
+        if (m_members.contains(handle))
+            registerSong(handle, m_playList->songInfo(handle));
+    }
+    m_pending.clear();
+}
+/**
+ * @brief Computes partial content hashes of given songs in parallel.
+ */
+void plaDuplicateDetector::computeHashes(const QSet<plaPathStore::Handle> &handles)
+{
+    if (handles.isEmpty())
+        return;
+    QList<plaPathStore::Handle> list;
+    list.reserve(handles.count());
+    foreach (plaPathStore::Handle handle, handles)
+        list.append(handle);
+    QStringList paths;
+    foreach (plaPathStore::Handle handle, list)
+        paths.append(m_playList->pathStore()->path(handle));
+    QList<QByteArray> hashes = QtConcurrent::blockingMapped<QList<QByteArray> >(paths, partialHash);
+    for (int i = 0; i < list.count(); i++)
+        m_hashes.insert(list.at(i), hashes.at(i));
+}
+/**
+ * @brief Hash of file size, first and last hashBlockSize bytes (whole file if it is small).
+ * @return Hash, empty if file could not be read
+ */
+QByteArray plaDuplicateDetector::partialHash(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    qint64 size = file.size();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData((const char *)&size, sizeof(size));
+    if (size <= 2 * hashBlockSize) {
+        hash.addData(file.readAll());
+    }
+    else {
+        hash.addData(file.read(hashBlockSize));
+        file.seek(size - hashBlockSize);
+        hash.addData(file.read(hashBlockSize));
+    }
+    return hash.result();
+}
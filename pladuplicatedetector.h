@@ -0,0 +1,66 @@
+#ifndef PLADUPLICATEDETECTOR_H
+#define PLADUPLICATEDETECTOR_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include "plapathstore.h"
+#include "plasonginfo.h"
+
+class plaPlayList;
+
+/**
+ * \brief plaDuplicateDetector finds songs that would be copied to player twice.
+ *
+ * Songs being added are checked against the playlist and against each other in three steps:
+ * \li same file: canonical path (symlinks resolved) or same device and inode (hard links, other case of path)
+ * \li size: only songs whose size equals size of some other song are examined further
+ * \li content: hash of size, head and tail blocks of the file, computed in parallel and only for songs in
+ *     colliding size buckets, so cost grows with number of real collisions, not with playlist size
+ *
+ * Same file is the same song and is not added again. Equal hashes mean (very probably) same content in
+ * another file, such songs are added but reported as duplicates.
+ *
+ * Identity (canonical path, device and inode) and size come from plaSongInfo, read with one stat per song.
+ * Detector follows playlist membership with setMembers() and addMembers(), members that were not checked
+ * when added (like restored session) are registered on next check() from cached metadata, without file
+ * system access. Cached metadata of a member is verified only when a candidate collides with it.
+ */
+class plaDuplicateDetector
+{
+public:
+    explicit plaDuplicateDetector(plaPlayList *playList);
+
+    QHash<plaPathStore::Handle, plaPathStore::Handle> check(const QVector<plaPathStore::Handle> &candidates,
+                                                             QVector<plaPathStore::Handle> *sameFiles);
+    void setMembers(const QVector<plaPathStore::Handle> &handles);
+    void addMembers(const QVector<plaPathStore::Handle> &handles);
+    void clear();
+
+private:
+    typedef QPair<quint64, quint64> FileId;     /**< device and inode */
+
+    plaPlayList *m_playList;
+    QSet<plaPathStore::Handle> m_members;       /**< songs in playlist (registered or pending) */
+    QVector<plaPathStore::Handle> m_pending;    /**< members that are not registered yet */
+    QHash<plaPathStore::Handle, plaSongInfo> m_registered;     /**< metadata songs were registered with */
+    QSet<plaPathStore::Handle> m_verified;      /**< songs checked against file system during current check() */
+    QHash<plaPathStore::Handle, QByteArray> m_hashes;
+    QHash<plaPathStore::Handle, plaPathStore::Handle> m_byCanonical;
+    QHash<FileId, plaPathStore::Handle> m_byFileId;
+    QHash<qint64, QVector<plaPathStore::Handle> > m_bySize;
+
+    bool sameFileRegistered(const plaSongInfo &info);
+    void verifyMember(plaPathStore::Handle handle);
+    void registerSong(plaPathStore::Handle handle, const plaSongInfo &info);
+    void unregisterSong(plaPathStore::Handle handle);
+    void registerPending();
+    void computeHashes(const QSet<plaPathStore::Handle> &handles);
+
+    static QByteArray partialHash(const QString &path);
+};
+
+#endif // PLADUPLICATEDETECTOR_H
@@ -1,36 +1,219 @@
 #include "plafile.h"
+#include "placopyscheduler.h"
+#include "plasession.h"
 #include <QApplication>
 #include <QByteArray>
 #include <QDateTime>
-#include <QDataStream>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QSet>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
 
 
 plaPlayList::plaPlayList(QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    m_session(0),
+    m_duplicates(this)
 {
     playlistName = "playlist.pla";
-    musicFileDestination = playlistDestination = QApplication::applicationDirPath();
+    playlistDestination = QApplication::applicationDirPath();
+    // music destination has no default, copying a whole playlist to a guessed place is never wanted
     preserveSongFolder = true;
+    deviceProfile = plaProfiles::indexOf("T20");
+}
+plaPlayList::~plaPlayList()
+{
+    delete m_session;
 }
 int plaPlayList::addFile(QString name)
 {
-    m_lstSrcFiles.append(name);
+    m_lstSrcFiles.append(m_paths.intern(name));
+    m_duplicates.addMembers(m_lstSrcFiles.mid(m_lstSrcFiles.count() - 1));
     return m_lstSrcFiles.count();
 }
 int plaPlayList::setFiles(QStringList names)
 {
-    m_lstSrcFiles = names;
+    m_lstSrcFiles = m_paths.intern(names);
+    m_duplicates.setMembers(m_lstSrcFiles);
+    pruneDuplicates();
     return m_lstSrcFiles.count();
 }
 int plaPlayList::addFiles(QStringList names)
 {
-    m_lstSrcFiles += names;
+    QVector<plaPathStore::Handle> handles = m_paths.intern(names);
+    m_lstSrcFiles += handles;
+    m_duplicates.addMembers(handles);
     return m_lstSrcFiles.count();
 }
+/**
+ * @brief Replaces playlist with songs given as pathStore() handles.
+ * @return Number of files in the playlist
+ */
+int plaPlayList::setHandles(QVector<plaPathStore::Handle> handles)
+{
+    m_lstSrcFiles = handles;
+    m_duplicates.setMembers(m_lstSrcFiles);
+    pruneDuplicates();
+    return m_lstSrcFiles.count();
+}
+int plaPlayList::addHandles(QVector<plaPathStore::Handle> handles)
+{
+    m_lstSrcFiles += handles;
+    m_duplicates.addMembers(handles);
+    return m_lstSrcFiles.count();
+}
+QVector<plaPathStore::Handle> plaPlayList::handles()
+{
+    return m_lstSrcFiles;
+}
+/**
+ * @brief Used to get the store that owns all song paths of this playlist, handles given by it are used as song ids.
+ */
+plaPathStore *plaPlayList::pathStore()
+{
+    return &m_paths;
+}
+/**
+ * @brief Checks songs that are about to be added for duplicates of playlist songs and of each other,
+ * see plaDuplicateDetector for details.
+ * @param candidates Songs to be added (not exact duplicates of playlist songs)
+ * @param sameFiles Candidates that are the same file as some other song, these should not be added
+ * @return Candidates that have the same content as some other song, mapped to that song
+ */
+QHash<plaPathStore::Handle, plaPathStore::Handle> plaPlayList::checkDuplicates(const QVector<plaPathStore::Handle> &candidates,
+                                                                               QVector<plaPathStore::Handle> *sameFiles)
+{
+    QHash<plaPathStore::Handle, plaPathStore::Handle> retVal = m_duplicates.check(candidates, sameFiles);
+    QHash<plaPathStore::Handle, plaPathStore::Handle>::const_iterator it = retVal.constBegin();
+    for (; it != retVal.constEnd(); ++it)
+        m_duplicateOf.insert(it.key(), it.value());
+    return retVal;
+}
+/**
+ * @brief Used to get duplicate songs found by checkDuplicates() that are still in playlist, also over sessions.
+ * @return Duplicate song mapped to the song that has same content
+ */
+QHash<plaPathStore::Handle, plaPathStore::Handle> plaPlayList::duplicates()
+{
+    return m_duplicateOf;
+}
+/**
+ * @brief Replaces known duplicates (like restored session), pairs whose songs are not in playlist are dropped.
+ */
+void plaPlayList::setDuplicates(const QHash<plaPathStore::Handle, plaPathStore::Handle> &duplicates)
+{
+    m_duplicateOf = duplicates;
+    pruneDuplicates();
+}
+/**
+ * @brief Forgets duplicate pairs where either song is not in playlist anymore.
+ */
+void plaPlayList::pruneDuplicates()
+{
+    if (m_duplicateOf.isEmpty())
+        return;
+    QSet<plaPathStore::Handle> members;
+    members.reserve(m_lstSrcFiles.count());
+    foreach (plaPathStore::Handle handle, m_lstSrcFiles)
+        members.insert(handle);
+    QHash<plaPathStore::Handle, plaPathStore::Handle>::iterator it = m_duplicateOf.begin();
+    while (it != m_duplicateOf.end()) {
+        if (members.contains(it.key()) && members.contains(it.value()))
+            ++it;
+        else
+            it = m_duplicateOf.erase(it);
+    }
+}
+/**
+ * @brief Used to get metadata of a song. Metadata is read from file system only when it is not cached
+ * in memory or in attached session snapshot, so it may be stale: use verifiedSongInfo() for decisions.
+ */
+plaSongInfo plaPlayList::songInfo(plaPathStore::Handle handle)
+{
+    plaSongInfo info;
+    if (cachedSongInfo(handle, &info))
+        return info;
+    return verifiedSongInfo(handle);
+}
+/**
+ * @brief Used to get metadata of a song as the file is now. File is checked with one stat on each call, cached
+ * metadata is replaced when file size, modification time or inode differs from it (file was replaced or re-encoded).
+ * Canonical path is resolved only for files that were not cached or have changed.
+ */
+plaSongInfo plaPlayList::verifiedSongInfo(plaPathStore::Handle handle)
+{
+    QString path = m_paths.path(handle);
+    plaSongInfo info;
+    info.size = 0;
+    info.modified = 0;
+    info.device = 0;
+    info.inode = 0;
+    info.canonical = handle;
+#ifdef Q_OS_UNIX
+    struct stat status;
+    if (::stat(QFile::encodeName(path).constData(), &status) == 0) {
+        info.size = status.st_size;
+        info.modified = (qint64)status.st_mtime * 1000;
+        info.device = status.st_dev;
+        info.inode = status.st_ino;
+    }
+#else
+    QFileInfo file(path);
+    info.size = file.size();
+    info.modified = file.lastModified().toMSecsSinceEpoch();
+#endif
+    plaSongInfo cached;
+    if (cachedSongInfo(handle, &cached) && cached.size == info.size && cached.modified == info.modified
+     && cached.device == info.device && cached.inode == info.inode)
+        return cached;
+    QString canonical = QFileInfo(path).canonicalFilePath();
+    if (!canonical.isEmpty() && canonical != path)
+        info.canonical = m_paths.intern(canonical);
+    m_songInfo.insert(handle, info);
+    return info;
+}
+/**
+ * @brief Used to get metadata of a song without any file system access.
+ * @return true if metadata was known, false otherwise
+ */
+bool plaPlayList::cachedSongInfo(plaPathStore::Handle handle, plaSongInfo *info)
+{
+    QHash<plaPathStore::Handle, plaSongInfo>::const_iterator it = m_songInfo.constFind(handle);
+    if (it != m_songInfo.constEnd()) {
+        *info = it.value();
+        return true;
+    }
+    if (m_session && m_session->songInfo(handle, info)) {
+        m_songInfo.insert(handle, *info);
+        return true;
+    }
+    return false;
+}
+/**
+ * @brief Attaches session snapshot from which cached metadata is read on demand, playlist takes ownership.
+ * Previous session and metadata cached from it are released, 0 just releases them.
+ */
+void plaPlayList::setSession(plaSession *session)
+{
+    if (session == m_session)
+        return;
+    delete m_session;
+    m_session = session;
+    m_songInfo.clear();
+}
+/**
+ * @brief Releases attached session snapshot (and the file it maps), metadata already decoded from it stays cached.
+ */
+void plaPlayList::releaseSession()
+{
+    delete m_session;
+    m_session = 0;
+}
 /**
  * @brief Extracts all files from specified directory and adds supported files to playlist
  * @param name Path to directory that will be checked
@@ -55,7 +238,7 @@ int plaPlayList::addDirectory(QString name)
  */
 QString plaPlayList::getPLAAsString()
 {
-    return m_lstSrcFiles.join("\r\n");
+    return m_paths.paths(m_lstSrcFiles).join("\r\n");
 }
 /**
  * @brief Returns a proper filter for 'FileOpen dialog', enumerates all supported file formats.
@@ -76,16 +259,39 @@ QStringList plaPlayList::filterSupportedFiles(QStringList files)
 {
     QStringList retVal;
     QString name;
+    const unsigned formats = supportedFormats();
     foreach (name, files) {
-        if (name.endsWith(plaSupportedFiles.ogg)
-         || name.endsWith(plaSupportedFiles.mp3)
-         || name.endsWith(plaSupportedFiles.flac)
-         || name.endsWith(plaSupportedFiles.wma))
+        if (formatOf(name) & formats)
             retVal.append(name);
     }
     qDebug() << "PlayList file anem filtering: suggested files count " << files.count() << ", accepted count " << retVal.count();
     return retVal;
 }
+/**
+ * @brief Used to get the file formats that selected device profile can play.
+ * @return plaFormat flags
+ */
+unsigned plaPlayList::supportedFormats()
+{
+    FormatsVisitor visitor;
+    return plaProfiles::visit(deviceProfile, visitor);
+}
+/**
+ * @brief Detects file format from file name...without actually checking the file content.
+ * @return plaFormat of the file, plaFormatNone if format is not known
+ */
+plaFormat plaPlayList::formatOf(QString name)
+{
+    if (name.endsWith(plaSupportedFiles.ogg))
+        return plaFormatOgg;
+    if (name.endsWith(plaSupportedFiles.mp3))
+        return plaFormatMp3;
+    if (name.endsWith(plaSupportedFiles.flac))
+        return plaFormatFlac;
+    if (name.endsWith(plaSupportedFiles.wma))
+        return plaFormatWma;
+    return plaFormatNone;
+}
 /**
  * @brief Used to get the number of files selected to playlist.
  * @return Number of files in the playlist.
@@ -107,77 +313,150 @@ bool plaPlayList::doWork()
     try {
         //
         // work list
+        // 0. select songs that the player can take to its playlist, others are neither copied nor listed
         // 1. generate destination files list (correct path information)
         // 2. check existence of destination files and filter out already existing ones
         // 3. check that we have enough space for missing files
         // 4. copy missing files to destination
         // 5. generate playlist and copy it to 'playlist destination'
         //
-        if (checkDestinationFilesAvailability())
-        OnReady();
-        return true;
+        if (musicFileDestination.isEmpty()) {
+            errorSignaling("ERROR", "Music file destination is not set, nothing is copied");
+            return false;
+        }
+        selectPlaylistSongs();
+        if (!checkDestinationFilesAvailability())
+            return false;
+        if (!copyMissingFilesToDestination())
+            return false;
+        return generatePLAFile();
     }
     catch (...) {
         qDebug() << "plaPlayList::generatePLAFile - Error while creating playlist";
         return false;
     }
 }
+/**
+ * Visitor that selects songs with the format and path limits of selected device profile.
+ */
+struct plaPlayList::SelectVisitor {
+    typedef int result_type;
+    plaPlayList *playList;
+    template <class Profile> int run() { return playList->selectPlaylistSongs<Profile>(); }
+};
+/**
+ * Visitor that generates PLA file with the encoder of selected device profile.
+ */
+struct plaPlayList::GenerateVisitor {
+    typedef bool result_type;
+    plaPlayList *playList;
+    template <class Profile> bool run() { return playList->generatePLAFile<Profile>(); }
+};
+/**
+ * Visitor that returns plaFormat flags supported by selected device profile.
+ */
+struct plaPlayList::FormatsVisitor {
+    typedef unsigned result_type;
+    template <class Profile> unsigned run() { return Profile::formats; }
+};
+
+/**
+ * @brief Selects songs of the playlist that selected player model can take, to m_lstPlaFiles.
+ * Copying and PLA generation both use this selection, so a song left out of PLA is never copied.
+ * @return Number of selected songs
+ */
+int plaPlayList::selectPlaylistSongs()
+{
+    SelectVisitor visitor;
+    visitor.playList = this;
+    return plaProfiles::visit(deviceProfile, visitor);
+}
+/**
+ * @brief Selects songs with the limits of given device profile, songs whose format the player can not
+ * play or whose path does not fit into one frame are skipped with a warning.
+ */
+template <class Profile>
+int plaPlayList::selectPlaylistSongs()
+{
+    m_lstPlaFiles.clear();
+    QString outputFile;
+    qint16 nameIndex = 0;
+    foreach (plaPathStore::Handle handle, m_lstSrcFiles) {
+        QString song = m_paths.path(handle);
+        // player model may have been changed after songs were added, filterSupportedFiles() checked the old one
+        if (!(formatOf(song) & Profile::formats)) {
+            errorSignaling("WARNING", QString("Song '%1' format is not supported by %2, skipping it").arg(song).arg(Profile::name()));
+            continue;
+        }
+        if (!plaPathMapper<Profile>::map(song, musicFileDestination, preserveSongFolder, &outputFile, &nameIndex)) {
+            errorSignaling("ERROR", QString("Song '%1' path and index extraction failed, skipping it").arg(song));
+            continue;
+        }
+        if (outputFile.size() > Profile::maxPathUnits) {
+            errorSignaling("WARNING", QString("Song '%1' path is longer than %2 characters in %3, skipping it").arg(outputFile).arg(Profile::maxPathUnits).arg(Profile::name()));
+            continue;
+        }
+        m_lstPlaFiles.append(handle);
+    }
+    return m_lstPlaFiles.count();
+}
 bool plaPlayList::generatePLAFile()
 {
     try {
         // 5. generate playlist
-        qint32 fileCount = (qint32)m_lstSrcFiles.count();
-        if (playlistName.isEmpty())
-            playlistName = "playlist.pla";
-        if (!playlistName.endsWith(".pla"))
-            playlistName.append(".pla");
-        QFile file(playlistDestination + "/" + playlistName);
-        file.open(QIODevice::Truncate | QIODevice::WriteOnly);
-        if (!file.isOpen()) {
-            qDebug() << "file does not open?";
-            return false;
-        }
-        QDataStream out(&file);
-        out.setByteOrder(QDataStream::BigEndian);
+        GenerateVisitor visitor;
+        visitor.playList = this;
+        return plaProfiles::visit(deviceProfile, visitor);
+    }
+    catch (...) {
+        qDebug() << "plaPlayList::generatePLAFile - Error while creating playlist";
+        return false;
+    }
+}
+/**
+ * @brief Generates PLA file with the frame layout, separator and path limits of given device profile.
+ * Songs are the ones chosen by selectPlaylistSongs(), header song count matches the written frames.
+ */
+template <class Profile>
+bool plaPlayList::generatePLAFile()
+{
+    if (playlistName.isEmpty())
+        playlistName = "playlist.pla";
+    if (!playlistName.endsWith(".pla"))
+        playlistName.append(".pla");
 
-        // Header info: qint32 (4 bytes) + iriver_text (14 bytes) = 18 bytes -> rest 494 bytes = 0
-        out << fileCount;
-        out.writeRawData(iriverText.toLatin1(), iriverText.size()); // tolatin1 is serialized as 'length,string' ->use writeRawData
-        int i = 494;
-        while (0 < i) {
-            out << (qint8)0;
-            --i;
+    // File Info
+    QByteArray songFrames;
+    qint32 fileCount = 0;
+    QString outputFile = "";
+    qint16 nameIndex = 0;
+    foreach (plaPathStore::Handle handle, m_lstPlaFiles) {
+        QString song = m_paths.path(handle);
+        if (!plaPathMapper<Profile>::map(song, musicFileDestination, preserveSongFolder, &outputFile, &nameIndex)) {
+            qDebug() << "Song " << song << " path and index extraction failed, PLA is not usable!";
+            errorSignaling("ERROR", QString("Song '%1' path and index extraction failed, PLA is not usable!").arg(song));
+            return false;
         }
+        qDebug() << " song: " << outputFile;
+        plaWriter<Profile>::appendSong(&songFrames, outputFile, nameIndex);
+        ++fileCount;
+    }
 
-        // File Info
-        QString outputFile = "";
-        qint16 nameIndex = 0;
-        foreach (QString song, m_lstSrcFiles) {
-            if (song.length()>=512) {
-                qDebug() << "Song " << song << " file path was too long, skipping it";
-                continue;
-            }
-            if(!getFileName(song, &outputFile, &nameIndex)) {
-                qDebug() << "Song " << song << " path and index extraction failed, PLA is not usable!";
-                errorSignaling("ERROR", QString("Song '%1' path and index extraction failed, PLA is not usable!").arg(song));
-                return false;
-            }
-            qDebug() << " song: " << outputFile;
-            out << nameIndex;
-            out << (qint8)0; // ugly workaround! put '00' byte before '\' mark which is missing from outputFile string (for some reason)?
-            out.writeRawData((const char*) outputFile.utf16(), outputFile.size() * 2);
-            for (int i=(3+outputFile.size()*2); i<512; i++)
-                out << (qint8)0;
-        }
-        qDebug() << "plaPlayList::generatePLAFile - data written, playlist size: " << file.size() << ", should be 512 + " << m_lstSrcFiles.count() << "*512 = " << 512 + m_lstSrcFiles.count() * 512;
-        file.close();
-        OnReady();
-        return true;
+    QFile file(playlistDestination + "/" + playlistName);
+    file.open(QIODevice::Truncate | QIODevice::WriteOnly);
+    if (!file.isOpen()) {
+        qDebug() << "file does not open?";
+        return false;
     }
-    catch (...) {
-        qDebug() << "plaPlayList::generatePLAFile - Error while creating playlist";
+    const QByteArray header = plaWriter<Profile>::header(fileCount);
+    if (file.write(header) != header.size() || file.write(songFrames) != songFrames.size()) {
+        errorSignaling("ERROR", QString("Writing playlist '%1' failed: %2").arg(file.fileName()).arg(file.errorString()));
         return false;
     }
+    qDebug() << "plaPlayList::generatePLAFile - data written, playlist size: " << file.size() << ", should be " << Profile::frameSize << " + " << fileCount << "*" << Profile::frameSize;
+    file.close();
+    OnReady();
+    return true;
 }
 
 /**
@@ -192,79 +471,80 @@ bool plaPlayList::checkPlaylistDestinationAvailability()
 /**
  * @brief Idea is to:
  * \li check that main level (folder) exists into which music files are copied
- * \li check destination if that already has some files that are selected in playlist and move nonexisting files to m_lstCopyFiles list
+ * \li check destination if that already has some files that are selected to PLA (m_lstPlaFiles) and move nonexisting files to m_lstCopyFiles list
  * @return true if music files destination folder (main level) exists and false otherwise
  */
 bool plaPlayList::checkDestinationFilesAvailability()
 {
-    QDir dir(musicFileDestination);
+    QString root = getLocalMusicRoot();
+    QDir dir(root);
     if (!dir.exists()) {
-        errorSignaling("ERROR", QString("Music file destination main directory (%1) did not exist?").arg(musicFileDestination));
+        errorSignaling("ERROR", QString("Music file destination main directory (%1) did not exist?").arg(root));
         return false;
     }
-    QStringList destinationFiles = dir.entryList(QDir::Files | QDir::NoDotAndDotDot);
-    QStringList dublicates;
-    QStringList::Iterator it = m_lstSrcFiles.begin();
-    QStringList::Iterator end = m_lstSrcFiles.end();
-    while (it != end) {
-        if (destinationFiles.contains(*it))
-            dublicates.append(*it);
-        ++it;
-    }
     m_lstCopyFiles.clear();
-    it = dublicates.begin();
-    end = dublicates.end();
-    while (it != end) {
-        if (!m_lstSrcFiles.contains(*it))
-            m_lstCopyFiles.append(*it);
-        ++it;
-    }
-    foreach (QString file, dublicates) {
-        qDebug() << " playlist item " << file << " already exists in destination " << musicFileDestination;
+    QHash<QString, plaPathStore::Handle> destinations;
+    foreach (plaPathStore::Handle handle, m_lstPlaFiles) {
+        // two songs with the same destination would be one file on player and two frames in PLA
+        QString destination = getLocalDestination(m_paths.path(handle));
+        QString key = destination.toCaseFolded();
+        if (destinations.contains(key)) {
+            errorSignaling("ERROR", QString("Songs '%1' and '%2' have the same destination '%3', nothing is copied")
+                           .arg(m_paths.path(destinations.value(key))).arg(m_paths.path(handle)).arg(destination));
+            return false;
+        }
+        destinations.insert(key, handle);
+        if (QFileInfo(destination).exists())
+            qDebug() << " playlist item " << m_paths.path(handle) << " already exists in destination " << root;
+        else
+            m_lstCopyFiles.append(handle);
     }
     return true;
 }
+/**
+ * @brief Copies files in m_lstCopyFiles to destination.
+ * Copying order is decided by plaCopyScheduler, not by playlist order, see plaCopyScheduler for details.
+ * @return true if all files were copied, false otherwise
+ */
 bool plaPlayList::copyMissingFilesToDestination()
 {
-    return true;
+    plaCopyScheduler scheduler;
+    connect(&scheduler, SIGNAL(OnError(QString,QString,QString)), this, SIGNAL(OnError(QString,QString,QString)));
+    connect(&scheduler, SIGNAL(OnFileCopied(QString,QString,QString)), this, SIGNAL(OnFileCopied(QString,QString,QString)));
+    foreach (plaPathStore::Handle handle, m_lstCopyFiles) {
+        QString song = m_paths.path(handle);
+        if (!scheduler.addTransfer(song, getLocalDestination(song)))
+            return false;
+    }
+    qDebug() << "plaPlayList::copyMissingFilesToDestination - files " << scheduler.transferCount() << ", bytes " << scheduler.totalBytes();
+    return scheduler.run();
 }
 /**
- * @brief Get the actual filename and possibly folder that will be written to PLA file
- * This program manages location of songs so, that user can define the 'root' for music
- * files under which all music files and folders will be copied or referenced. Similarly
- * user can define the location for Playlist files generated by this program. iRiver
- * interprets playlist paths so that '/' references to the root of music player.
- *
- * If user has checked that 'preserve folder' then playlist references files so that
- * it adds the immediate folder where song exists beneath the 'music root' so:
- * 'music root'/'folder'/'song'. The other choice is 'music root'/'song'
- *
- * @param fi Input file to be examined
- * @param outFile Name of the file + one folder level above it if preserveSongFolder is true
- * @param nameIndex 1 based position in absolutefilepath from which the actual filename starts
- * @return true if successfully retrieved information, false otherwise
+ * @brief Used to get the music root as a local path.
+ * musicFileDestination given relative to iRiver root (starts with '\\') is located under playlistDestination,
+ * which is expected to be the mount point of the player. Otherwise musicFileDestination is a local path as such.
+ * @return Local directory under which music files are copied
  */
-bool plaPlayList::getFileName(QString song, QString *outFile, qint16 *nameIndex)
+QString plaPlayList::getLocalMusicRoot()
 {
-    QFileInfo inputFile(song);
-    *outFile = "";
-    *nameIndex = 0;
-    if (inputFile.absoluteFilePath().isEmpty())
-        return false;
-    QString folderName = "";
-    QString fileName = "";
-    if (preserveSongFolder) {
-        folderName = inputFile.absoluteDir().dirName();
-    }
-    if (preserveSongFolder) {
-        fileName = QString("%1\\%2\\%3").arg(musicFileDestination).arg(folderName).arg(inputFile.fileName());
+    QString root = musicFileDestination;
+    if (root.startsWith("\\")) {
+        root.replace("\\", "/");
+        return QDir::cleanPath(playlistDestination + root);
     }
-    else {
-        fileName = QString("%1\\%2").arg(musicFileDestination).arg(inputFile.fileName());
-    }
-    *outFile = fileName;
-    *nameIndex = (qint16)outFile->indexOf(inputFile.fileName()) + 1;
-    return true;
+    return QDir::cleanPath(root);
+}
+/**
+ * @brief Used to get the local path into which a song is copied, same folder logic as in plaPathMapper.
+ * @param song Source file
+ * @return Local destination file path
+ */
+QString plaPlayList::getLocalDestination(QString song)
+{
+    QFileInfo inputFile(song);
+    if (preserveSongFolder)
+        return QString("%1/%2/%3").arg(getLocalMusicRoot()).arg(inputFile.absoluteDir().dirName()).arg(inputFile.fileName());
+    return QString("%1/%2").arg(getLocalMusicRoot()).arg(inputFile.fileName());
 }
 /**
  * @brief Verify that we can copy all necessary files to destination and that device has enough free diskspace.
@@ -283,11 +563,8 @@ bool plaPlayList::checkIfIEnoughCapacity(int *deviceTotal, int *neededSize)
     foreach( QFileInfo info, drives)
         qDebug() << " " << info.absolutePath();
     // find out needed space
-    QFileInfo fi;
-    foreach (QString file, m_lstCopyFiles) {
-        fi.setFile(file);
-        *neededSize += fi.size();
-    }
+    foreach (plaPathStore::Handle handle, m_lstCopyFiles)
+        *neededSize += verifiedSongInfo(handle).size;
     return true;
 }
 /**
@@ -1,11 +1,18 @@
 #ifndef PLAFILE_H
 #define PLAFILE_H
 
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include "pladuplicatedetector.h"
+#include "plapathstore.h"
+#include "plaprofile.h"
+#include "plasonginfo.h"
 
 class QFileInfo;
+class plaSession;
+
 
 /**
  * \brief plaFile implements the file support itself, it understands the structure of PLA format.
@@ -21,7 +28,7 @@ class QFileInfo;
  * index comes the song's null-terminated full filename. As the filesystem type is VFAT, it is encoded as big-endian
  * UTF-16 without a byte order mark. Absolute paths used. The index and filename are all there is in a single song frame.
  * Note that the filename must fit into one 512-byte frame. So the filename, including the directory part, can have at
- * most 255 (two-byte) characters. The player-accompanied iriver plus program seems to mess up your data without warning
+ * most 255 (two-byte) characters including the terminating null, which leaves 254 for the path itself. The player-accompanied iriver plus program seems to mess up your data without warning
  * if you happen to use more than 255 characters, so don't do that.
  *
  * Ex. Header frame (512 byte array)
@@ -33,6 +40,9 @@ class QFileInfo;
  * [0000] 16 bit, 1 based index position number that specifies where the actual song filename starts in the path
  * [...] UTF-16 absolute, full file path (null terminated), make sure 512 bytes is not exceeded for each song!
  *
+ * Layout above is the T20 one. Frame size, header text, path limits, separator and supported formats of each
+ * player model are declared as device profiles in plaprofile.h, deviceProfile selects the one used.
+ *
  * Program usage
  *
  * \li Select the files you would like to have in destination
@@ -50,40 +60,72 @@ class plaPlayList : public QObject
     Q_OBJECT
 private:
     // Private variables and methods
-    QStringList m_lstSrcFiles;
-    QStringList m_lstCopyFiles;
+    plaPathStore m_paths;
+    QVector<plaPathStore::Handle> m_lstSrcFiles;
+    QVector<plaPathStore::Handle> m_lstCopyFiles;
+    QVector<plaPathStore::Handle> m_lstPlaFiles;    /**< songs the selected player takes to its playlist, see selectPlaylistSongs() */
+    QHash<plaPathStore::Handle, plaSongInfo> m_songInfo;
+    plaSession *m_session;
+    plaDuplicateDetector m_duplicates;
+    QHash<plaPathStore::Handle, plaPathStore::Handle> m_duplicateOf;  /**< duplicate song mapped to song with same content */
 
+    int selectPlaylistSongs();
+    template <class Profile> int selectPlaylistSongs();
     bool checkPlaylistDestinationAvailability();
     bool checkDestinationFilesAvailability();
     bool copyMissingFilesToDestination();
-    bool getFileName(QString song, QString*outFile, qint16*);
+    QString getLocalMusicRoot();
+    QString getLocalDestination(QString song);
     bool checkIfIEnoughCapacity(int* deviceTotal, int* neededSize);
     bool generatePLAFile();
+    template <class Profile> bool generatePLAFile();
+    void pruneDuplicates();
     void errorSignaling(QString category, QString message);
 
+    struct SelectVisitor;
+    struct GenerateVisitor;
+    struct FormatsVisitor;
+
 public:
     // Public interface
     explicit plaPlayList(QObject *parent = 0);
+    ~plaPlayList();
 
     int addFile(QString name);
     int addFiles(QStringList names);
     int addDirectory(QString name);
     int setFiles(QStringList names);
+    int setHandles(QVector<plaPathStore::Handle> handles);
+    int addHandles(QVector<plaPathStore::Handle> handles);
+    QVector<plaPathStore::Handle> handles();
+    plaPathStore *pathStore();
+
+    QHash<plaPathStore::Handle, plaPathStore::Handle> checkDuplicates(const QVector<plaPathStore::Handle> &candidates,
+                                                                      QVector<plaPathStore::Handle> *sameFiles);
+    QHash<plaPathStore::Handle, plaPathStore::Handle> duplicates();
+    void setDuplicates(const QHash<plaPathStore::Handle, plaPathStore::Handle> &duplicates);
+    plaSongInfo songInfo(plaPathStore::Handle handle);
+    plaSongInfo verifiedSongInfo(plaPathStore::Handle handle);
+    bool cachedSongInfo(plaPathStore::Handle handle, plaSongInfo *info);
+    void setSession(plaSession *session);
+    void releaseSession();
 
     bool doWork();
     QString getPLAAsString();
 
     QString getFileFilter();
     QStringList filterSupportedFiles(QStringList);
+    unsigned supportedFormats();
+    plaFormat formatOf(QString name);
 
     long playlistFileAmount();
     long plaContentSize();
 
-    QString musicFileDestination;
+    QString musicFileDestination;   /**< empty until user selects it, doWork() refuses to copy without it */
     QString playlistDestination;
     QString playlistName;
     bool preserveSongFolder;
-    const QString iriverText = "iriver UMS PLA"; /**<  constant text to be written to header part of PLA */
+    int deviceProfile;  /**< index of selected player model in plaProfiles, see plaprofile.h */
 
     /** Struct defines supported file types this program supports. */
     struct {
@@ -0,0 +1,265 @@
+#include "plapathstore.h"
+#include <QDataStream>
+
+
+plaPathStore::plaPathStore()
+{
+    clear();
+}
+/**
+ * @brief Used to get handle of a path, path is added to store if it is not there yet.
+ */
+plaPathStore::Handle plaPathStore::intern(const QString &path)
+{
+    int separator = path.lastIndexOf('/');
+    DirectoryId directory = separator < 0 ? noDirectory : internDirectory(path.left(separator));
+    QPair<DirectoryId, QString> key(directory, path.mid(separator + 1));
+    QHash<QPair<DirectoryId, QString>, Handle>::const_iterator it = m_entryLookup.constFind(key);
+    if (it != m_entryLookup.constEnd())
+        return it.value();
+    Entry entry;
+    entry.directory = directory;
+    entry.fileName = key.second;
+    Handle handle = m_entries.count();
+    m_entries.append(entry);
+    m_entryLookup.insert(key, handle);
+    return handle;
+}
+QVector<plaPathStore::Handle> plaPathStore::intern(const QStringList &paths)
+{
+    QVector<Handle> retVal;
+    retVal.reserve(paths.count());
+    foreach (const QString &path, paths)
+        retVal.append(intern(path));
+    return retVal;
+}
+/**
+ * @brief Used to get handle of a path without adding it to store.
+ * @return true if path is in store, false otherwise
+ */
+bool plaPathStore::find(const QString &path, Handle *handle) const
+{
+    int separator = path.lastIndexOf('/');
+    DirectoryId directory = noDirectory;
+    if (separator >= 0 && !findDirectory(path.left(separator), &directory))
+        return false;
+    QHash<QPair<DirectoryId, QString>, Handle>::const_iterator it = m_entryLookup.constFind(qMakePair(directory, path.mid(separator + 1)));
+    if (it == m_entryLookup.constEnd())
+        return false;
+    *handle = it.value();
+    return true;
+}
+/**
+ * @brief Used to get full path of a song, path is built from directory table on each call.
+ */
+QString plaPathStore::path(Handle handle) const
+{
+    const Entry &entry = m_entries.at(handle);
+    if (entry.directory == noDirectory)
+        return entry.fileName;
+    return directoryPathOf(entry.directory) + '/' + entry.fileName;
+}
+QStringList plaPathStore::paths(const QVector<Handle> &handles) const
+{
+    QStringList retVal;
+    retVal.reserve(handles.count());
+    foreach (Handle handle, handles)
+        retVal.append(path(handle));
+    return retVal;
+}
+QString plaPathStore::fileName(Handle handle) const
+{
+    return m_entries.at(handle).fileName;
+}
+/**
+ * @brief Used to get id of the directory where song is, songs in the same directory have the same id.
+ * @return Directory id, noDirectory if path has no directory part
+ */
+plaPathStore::DirectoryId plaPathStore::directory(Handle handle) const
+{
+    return m_entries.at(handle).directory;
+}
+/**
+ * @brief Used to get path of the directory where song is, without trailing separator.
+ */
+QString plaPathStore::directoryPath(Handle handle) const
+{
+    return directoryPathOf(m_entries.at(handle).directory);
+}
+/**
+ * @brief Used to get name of the directory where song is (last directory level only).
+ */
+QString plaPathStore::directoryName(Handle handle) const
+{
+    return m_directories.at(m_entries.at(handle).directory).name;
+}
+/**
+ * @brief Used to get the number of distinct paths in store.
+ */
+int plaPathStore::count() const
+{
+    return m_entries.count();
+}
+/**
+ * @brief Used to get the number of distinct directory levels in store.
+ */
+int plaPathStore::directoryCount() const
+{
+    return m_directories.count() - 1;
+}
+/**
+ * @brief Forgets all paths, all handles given earlier become invalid.
+ */
+void plaPathStore::clear()
+{
+    m_directories.clear();
+    m_directoryLookup.clear();
+    m_entries.clear();
+    m_entryLookup.clear();
+    Directory none;
+    none.parent = noDirectory;
+    m_directories.append(none);
+}
+/**
+ * @brief Used to get a copy of store that has only given songs and the directories they are in.
+ * Handles of the copy are renumbered in order of first appearance in handles.
+ * @param handles Songs to keep
+ * @param renumbered Handle in the copy of each song in handles, in the same order
+ * @param original Handle in this store of each song in the copy, by handle in the copy
+ */
+plaPathStore plaPathStore::compacted(const QVector<Handle> &handles, QVector<Handle> *renumbered, QVector<Handle> *original) const
+{
+    plaPathStore retVal;
+    QVector<DirectoryId> copied(m_directories.count(), noDirectory);
+    QHash<Handle, Handle> copiedEntries;
+    renumbered->clear();
+    original->clear();
+    foreach (Handle handle, handles) {
+        QHash<Handle, Handle>::const_iterator it = copiedEntries.constFind(handle);
+        if (it != copiedEntries.constEnd()) {
+            renumbered->append(it.value());
+            continue;
+        }
+        const Entry &entry = m_entries.at(handle);
+        Entry copy;
+        copy.directory = retVal.copyDirectory(*this, entry.directory, &copied);
+        copy.fileName = entry.fileName;
+        Handle copyHandle = retVal.m_entries.count();
+        retVal.m_entries.append(copy);
+        retVal.m_entryLookup.insert(qMakePair(copy.directory, copy.fileName), copyHandle);
+        copiedEntries.insert(handle, copyHandle);
+        renumbered->append(copyHandle);
+        original->append(handle);
+    }
+    return retVal;
+}
+/**
+ * @brief Writes directory table and songs to stream, in handle order.
+ */
+void plaPathStore::save(QDataStream &out) const
+{
+    out << (quint32)(m_directories.count() - 1);
+    for (int i = 1; i < m_directories.count(); i++)
+        out << m_directories.at(i).parent << m_directories.at(i).name;
+    out << (quint32)m_entries.count();
+    foreach (const Entry &entry, m_entries)
+        out << entry.directory << entry.fileName;
+}
+/**
+ * @brief Replaces store content with one written by save(), handles are the same as in saved store.
+ * @return true if stream was valid, false otherwise (store is left empty)
+ */
+bool plaPathStore::load(QDataStream &in)
+{
+    clear();
+    quint32 count = 0;
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        Directory directory;
+        in >> directory.parent >> directory.name;
+        if (directory.parent >= (DirectoryId)m_directories.count())
+            break;
+        m_directoryLookup.insert(qMakePair(directory.parent, directory.name), m_directories.count());
+        m_directories.append(directory);
+    }
+    if (m_directories.count() != (int)count + 1) {
+        clear();
+        return false;
+    }
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        Entry entry;
+        in >> entry.directory >> entry.fileName;
+        if (entry.directory >= (DirectoryId)m_directories.count())
+            break;
+        m_entryLookup.insert(qMakePair(entry.directory, entry.fileName), m_entries.count());
+        m_entries.append(entry);
+    }
+    if (m_entries.count() != (int)count || in.status() != QDataStream::Ok) {
+        clear();
+        return false;
+    }
+    return true;
+}
+/**
+ * @brief Adds all levels of directory path to directory table.
+ * Leading separator is kept as a directory with empty name, so '/home' is '' + 'home'.
+ */
+plaPathStore::DirectoryId plaPathStore::internDirectory(const QString &path)
+{
+    DirectoryId parent = noDirectory;
+    foreach (const QString &name, path.split('/')) {
+        QPair<DirectoryId, QString> key(parent, name);
+        QHash<QPair<DirectoryId, QString>, DirectoryId>::const_iterator it = m_directoryLookup.constFind(key);
+        if (it != m_directoryLookup.constEnd()) {
+            parent = it.value();
+            continue;
+        }
+        Directory directory;
+        directory.parent = parent;
+        directory.name = name;
+        parent = m_directories.count();
+        m_directories.append(directory);
+        m_directoryLookup.insert(key, parent);
+    }
+    return parent;
+}
+/**
+ * @brief Copies directory of another store with its parents to this store, parents get smaller ids than children.
+ * @param copied Directory id in this store by id in other store, noDirectory for directories not copied yet
+ */
+plaPathStore::DirectoryId plaPathStore::copyDirectory(const plaPathStore &from, DirectoryId id, QVector<DirectoryId> *copied)
+{
+    if (id == noDirectory || copied->at(id) != noDirectory)
+        return copied->at(id);
+    const Directory &directory = from.m_directories.at(id);
+    Directory copy;
+    copy.parent = copyDirectory(from, directory.parent, copied);
+    copy.name = directory.name;
+    DirectoryId copyId = m_directories.count();
+    m_directories.append(copy);
+    m_directoryLookup.insert(qMakePair(copy.parent, copy.name), copyId);
+    (*copied)[id] = copyId;
+    return copyId;
+}
+bool plaPathStore::findDirectory(const QString &path, DirectoryId *id) const
+{
+    DirectoryId parent = noDirectory;
+    foreach (const QString &name, path.split('/')) {
+        QHash<QPair<DirectoryId, QString>, DirectoryId>::const_iterator it = m_directoryLookup.constFind(qMakePair(parent, name));
+        if (it == m_directoryLookup.constEnd())
+            return false;
+        parent = it.value();
+    }
+    *id = parent;
+    return true;
+}
+QString plaPathStore::directoryPathOf(DirectoryId id) const
+{
+    if (id == noDirectory)
+        return QString();
+    const Directory &directory = m_directories.at(id);
+    if (directory.parent == noDirectory)
+        return directory.name;
+    return directoryPathOf(directory.parent) + '/' + directory.name;
+}
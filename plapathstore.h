@@ -0,0 +1,73 @@
+#ifndef PLAPATHSTORE_H
+#define PLAPATHSTORE_H
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QDataStream;
+
+/**
+ * \brief plaPathStore keeps song paths in compact form and gives each distinct path an integer handle.
+ *
+ * Directories are kept in a directory table where each directory is stored as a parent directory id and
+ * its own name, so a shared prefix like '/home/user/Music' is stored once however many songs are under it.
+ * A song is a directory id plus file name. Playlist, copy list and playlist view all refer to songs with
+ * handles: same path always gets the same handle, so comparing songs is an integer compare.
+ *
+ * Handles are small consecutive integers starting from 0 and they stay valid as long as the store exists,
+ * store never forgets a path. Store can be saved and loaded with handles unchanged, and compacted() gives a copy
+ * that has only the songs still in use. Paths are expected to use '/' as separator (as Qt does).
+ */
+class plaPathStore
+{
+public:
+    typedef quint32 Handle;
+    typedef quint32 DirectoryId;
+    enum { noDirectory = 0 };   /**< directory of a path without separators */
+
+    plaPathStore();
+
+    Handle intern(const QString &path);
+    QVector<Handle> intern(const QStringList &paths);
+    bool find(const QString &path, Handle *handle) const;
+
+    QString path(Handle handle) const;
+    QStringList paths(const QVector<Handle> &handles) const;
+    QString fileName(Handle handle) const;
+    DirectoryId directory(Handle handle) const;
+    QString directoryPath(Handle handle) const;
+    QString directoryName(Handle handle) const;
+
+    int count() const;
+    int directoryCount() const;
+    void clear();
+
+    plaPathStore compacted(const QVector<Handle> &handles, QVector<Handle> *renumbered, QVector<Handle> *original) const;
+    void save(QDataStream &out) const;
+    bool load(QDataStream &in);
+
+private:
+    struct Directory {
+        DirectoryId parent;
+        QString name;
+    };
+    struct Entry {
+        DirectoryId directory;
+        QString fileName;
+    };
+
+    QVector<Directory> m_directories;
+    QHash<QPair<DirectoryId, QString>, DirectoryId> m_directoryLookup;
+    QVector<Entry> m_entries;
+    QHash<QPair<DirectoryId, QString>, Handle> m_entryLookup;
+
+    DirectoryId internDirectory(const QString &path);
+    DirectoryId copyDirectory(const plaPathStore &from, DirectoryId id, QVector<DirectoryId> *copied);
+    bool findDirectory(const QString &path, DirectoryId *id) const;
+    QString directoryPathOf(DirectoryId id) const;
+};
+
+#endif // PLAPATHSTORE_H
@@ -0,0 +1,194 @@
+#include "plaplaylistmodel.h"
+#include <QBrush>
+#include <algorithm>
+#include <functional>
+
+
+plaPlaylistModel::plaPlaylistModel(const plaPathStore *store, QObject *parent) :
+    QAbstractListModel(parent),
+    m_store(store),
+    m_index(store),
+    m_indexValid(true)
+{
+}
+int plaPlaylistModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return m_handles.count();
+}
+QVariant plaPlaylistModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_handles.count())
+        return QVariant();
+    plaPathStore::Handle handle = m_handles.at(index.row());
+    if (role == Qt::DisplayRole)
+        return m_store->path(handle);
+    if (role == HandleRole)
+        return handle;
+    QHash<plaPathStore::Handle, plaPathStore::Handle>::const_iterator duplicate = m_duplicateOf.constFind(handle);
+    if (role == Qt::ToolTipRole) {
+        if (duplicate == m_duplicateOf.constEnd())
+            return m_store->path(handle);
+        return tr("%1\nSame content as %2").arg(m_store->path(handle)).arg(m_store->path(duplicate.value()));
+    }
+    if (role == DuplicateRole && duplicate != m_duplicateOf.constEnd())
+        return duplicate.value();
+    if (role == Qt::ForegroundRole && duplicate != m_duplicateOf.constEnd())
+        return QBrush(Qt::red);
+    return QVariant();
+}
+/**
+ * @brief Used to get all songs in playlist order.
+ */
+QVector<plaPathStore::Handle> plaPlaylistModel::handles() const
+{
+    return m_handles;
+}
+bool plaPlaylistModel::contains(plaPathStore::Handle handle) const
+{
+    return m_handleSet.contains(handle);
+}
+/**
+ * @brief Appends songs to the end of playlist, caller takes care of filtering out duplicates.
+ */
+void plaPlaylistModel::addHandles(QVector<plaPathStore::Handle> handles)
+{
+    if (handles.isEmpty())
+        return;
+    beginInsertRows(QModelIndex(), m_handles.count(), m_handles.count() + handles.count() - 1);
+    foreach (plaPathStore::Handle handle, handles) {
+        if (m_indexValid)
+            m_index.add(handle);
+        m_handles.append(handle);
+        m_handleSet.insert(handle);
+    }
+    endInsertRows();
+    emit songsChanged();
+}
+/**
+ * @brief Replaces whole playlist.
+ */
+void plaPlaylistModel::setHandles(QVector<plaPathStore::Handle> handles)
+{
+    beginResetModel();
+    m_handles.clear();
+    m_handleSet.clear();
+    m_index.clear();
+    m_indexValid = false;
+    m_handles = handles;
+    foreach (plaPathStore::Handle handle, handles)
+        m_handleSet.insert(handle);
+    pruneDuplicates();
+    endResetModel();
+    emit songsChanged();
+}
+/**
+ * @brief Removes given rows, rows can be in any order. Consecutive rows are removed as one range.
+ */
+void plaPlaylistModel::removeFileRows(QList<int> rows)
+{
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    bool removed = false;
+    int i = 0;
+    while (i < rows.count()) {
+        int last = rows.at(i);
+        int first = last;
+        while (++i < rows.count() && (rows.at(i) == first - 1 || rows.at(i) == first)) {
+            first = rows.at(i);
+        }
+        if (first < 0 || last >= m_handles.count())
+            continue;
+        beginRemoveRows(QModelIndex(), first, last);
+        for (int row = last; row >= first; row--) {
+            if (m_indexValid)
+                m_index.remove(m_handles.at(row));
+            m_handleSet.remove(m_handles.at(row));
+        }
+        m_handles.remove(first, last - first + 1);
+        endRemoveRows();
+        removed = true;
+    }
+    if (!removed)
+        return;
+    if (!m_duplicateOf.isEmpty()) {
+        pruneDuplicates();
+        if (!m_handles.isEmpty())
+            emit dataChanged(index(0), index(m_handles.count() - 1));
+    }
+    emit songsChanged();
+}
+/**
+ * @brief Reorders playlist in one operation, selections and other persistent indexes follow their rows.
+ * @param rows New order given as current row numbers, must contain every row exactly once
+ */
+void plaPlaylistModel::reorder(const QVector<int> &rows)
+{
+    if (rows.count() != m_handles.count())
+        return;
+    emit layoutAboutToBeChanged();
+    QVector<plaPathStore::Handle> handles(rows.count());
+    QVector<int> newRow(rows.count());
+    for (int i = 0; i < rows.count(); i++) {
+        handles[i] = m_handles.at(rows.at(i));
+        newRow[rows.at(i)] = i;
+    }
+    m_handles = handles;
+    QModelIndexList from = persistentIndexList();
+    QModelIndexList to;
+    foreach (const QModelIndex &index, from)
+        to.append(this->index(newRow.at(index.row())));
+    changePersistentIndexList(from, to);
+    emit layoutChanged();
+}
+/**
+ * @brief Marks songs as duplicates of other songs in playlist.
+ * @param duplicates Duplicate song mapped to the song that has same content
+ */
+void plaPlaylistModel::markDuplicates(const QHash<plaPathStore::Handle, plaPathStore::Handle> &duplicates)
+{
+    if (duplicates.isEmpty())
+        return;
+    QHash<plaPathStore::Handle, plaPathStore::Handle>::const_iterator it = duplicates.constBegin();
+    for (; it != duplicates.constEnd(); ++it)
+        m_duplicateOf.insert(it.key(), it.value());
+    pruneDuplicates();
+    if (!m_handles.isEmpty())
+        emit dataChanged(index(0), index(m_handles.count() - 1));
+}
+/**
+ * @brief Used to get the number of songs marked as duplicates.
+ */
+int plaPlaylistModel::duplicateCount() const
+{
+    return m_duplicateOf.count();
+}
+/**
+ * @brief Forgets duplicate marks of songs that are not in playlist and of songs whose original is not in playlist.
+ */
+void plaPlaylistModel::pruneDuplicates()
+{
+    QHash<plaPathStore::Handle, plaPathStore::Handle>::iterator it = m_duplicateOf.begin();
+    while (it != m_duplicateOf.end()) {
+        if (m_handleSet.contains(it.key()) && m_handleSet.contains(it.value()))
+            ++it;
+        else
+            it = m_duplicateOf.erase(it);
+    }
+}
+plaPathStore::Handle plaPlaylistModel::handleAt(int row) const
+{
+    return m_handles.at(row);
+}
+/**
+ * @brief Used to get search index of the playlist, index is built here if it is not up to date.
+ */
+plaSearchIndex *plaPlaylistModel::searchIndex()
+{
+    if (!m_indexValid) {
+        foreach (plaPathStore::Handle handle, m_handles)
+            m_index.add(handle);
+        m_indexValid = true;
+    }
+    return &m_index;
+}
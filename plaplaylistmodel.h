@@ -0,0 +1,61 @@
+#ifndef PLAPLAYLISTMODEL_H
+#define PLAPLAYLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include "plapathstore.h"
+#include "plasearchindex.h"
+
+/**
+ * \brief plaPlaylistModel holds the songs shown in playlist view, in playlist order.
+ *
+ * Rows are plaPathStore handles, paths are built from the store only when view asks them. Handles are
+ * also the ids in search index which model keeps up to date as songs are added, set and removed.
+ * Index of a playlist given with setHandles() (like restored session) is built only when it is first needed.
+ * Songs marked as duplicates (see plaDuplicateDetector) are shown in red with the original in tooltip.
+ * songsChanged() is emitted once after each add, set or remove, however many row ranges it touched.
+ * Use plaSearchProxy between model and view to filter rows with search text.
+ */
+class plaPlaylistModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum {
+        HandleRole = Qt::UserRole + 1,  /**< plaPathStore handle of the song (quint32) */
+        DuplicateRole                   /**< handle of the song that has same content, invalid if song is not a duplicate */
+    };
+
+    explicit plaPlaylistModel(const plaPathStore *store, QObject *parent = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    QVector<plaPathStore::Handle> handles() const;
+    bool contains(plaPathStore::Handle handle) const;
+    void addHandles(QVector<plaPathStore::Handle> handles);
+    void setHandles(QVector<plaPathStore::Handle> handles);
+    void removeFileRows(QList<int> rows);
+    void reorder(const QVector<int> &rows);
+    void markDuplicates(const QHash<plaPathStore::Handle, plaPathStore::Handle> &duplicates);
+    int duplicateCount() const;
+
+    plaPathStore::Handle handleAt(int row) const;
+    plaSearchIndex *searchIndex();
+
+signals:
+    void songsChanged();        /**< songs were added, set or removed, emitted once per operation */
+
+private:
+    void pruneDuplicates();
+
+    const plaPathStore *m_store;
+    QVector<plaPathStore::Handle> m_handles;
+    QSet<plaPathStore::Handle> m_handleSet;    /**< for fast duplicate checks */
+    QHash<plaPathStore::Handle, plaPathStore::Handle> m_duplicateOf;
+    plaSearchIndex m_index;
+    bool m_indexValid;          /**< false until index is built for handles given with setHandles() */
+};
+
+#endif // PLAPLAYLISTMODEL_H
@@ -0,0 +1,200 @@
+#ifndef PLAPROFILE_H
+#define PLAPROFILE_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QFileInfo>
+#include <QString>
+#include <QStringList>
+#include <cstring>
+
+/**
+ * \brief Device profiles describe how PLA file is written for one iRiver player model.
+ *
+ * Each profile is a traits struct with compile time constants only:
+ * \li name(), model name shown to user
+ * \li frameSize, size of header and song frames in bytes
+ * \li magic(), countBytes, magicOffset, header layout (song count is a big-endian integer of countBytes at offset 0)
+ * \li maxPathUnits, maximum number of UTF-16 units in song path, not counting the terminating null unit
+ * \li separator, directory separator used in song paths
+ * \li formats, plaFormat flags of file formats the player can play
+ *
+ * plaPathMapper and plaWriter are templated on profile, so each player model gets its own specialized
+ * encoder without run time checks. plaWriter checks at compile time that header and song frames fit into frameSize. New model is supported by declaring its traits struct and adding
+ * it to plaProfiles list at the end of this file.
+ */
+
+/** File formats known by this program, used as flags in profile formats. */
+enum plaFormat {
+    plaFormatNone = 0x00,
+    plaFormatMp3 = 0x01,
+    plaFormatWma = 0x02,
+    plaFormatOgg = 0x04,
+    plaFormatFlac = 0x08
+};
+
+/** Common T-series / H-series PLA layout: 512 byte frames, 'iriver UMS PLA' header, backslash separated paths. */
+struct plaProfileUms {
+    static constexpr int frameSize = 512;
+    static constexpr int countBytes = 4;
+    static constexpr int magicOffset = 4;
+    static constexpr const char *magic() { return "iriver UMS PLA"; }
+    static constexpr int maxPathUnits = 254;      /**< 2 byte index + 254 units + null unit = 512 bytes */
+    static constexpr char separator = '\\';
+};
+struct plaProfileT10 : plaProfileUms {
+    static constexpr const char *name() { return "T10"; }
+    static constexpr unsigned formats = plaFormatMp3 | plaFormatWma | plaFormatOgg;
+};
+struct plaProfileT20 : plaProfileUms {
+    static constexpr const char *name() { return "T20"; }
+    static constexpr unsigned formats = plaFormatMp3 | plaFormatWma | plaFormatOgg | plaFormatFlac;
+};
+struct plaProfileT50 : plaProfileUms {
+    static constexpr const char *name() { return "T50"; }
+    static constexpr unsigned formats = plaFormatMp3 | plaFormatWma;
+};
+struct plaProfileH10 : plaProfileUms {
+    static constexpr const char *name() { return "H10"; }
+    static constexpr unsigned formats = plaFormatMp3 | plaFormatWma;
+};
+
+
+/**
+ * \brief Maps local song files to paths written to PLA file.
+ */
+template <class Profile>
+struct plaPathMapper
+{
+    /**
+     * @brief Get the actual filename and possibly folder that will be written to PLA file
+     * This program manages location of songs so, that user can define the 'root' for music
+     * files under which all music files and folders will be copied or referenced. Similarly
+     * user can define the location for Playlist files generated by this program. iRiver
+     * interprets playlist paths so that '/' references to the root of music player.
+     *
+     * If user has checked that 'preserve folder' then playlist references files so that
+     * it adds the immediate folder where song exists beneath the 'music root' so:
+     * 'music root'/'folder'/'song'. The other choice is 'music root'/'song'
+     *
+     * @param song Input file to be examined
+     * @param musicRoot Music root in player
+     * @param preserveSongFolder true if one folder level above song is kept
+     * @param outFile Name of the file + one folder level above it if preserveSongFolder is true
+     * @param nameIndex 1 based position in outFile from which the actual filename starts
+     * @return true if successfully retrieved information, false otherwise
+     */
+    static bool map(const QString &song, const QString &musicRoot, bool preserveSongFolder, QString *outFile, qint16 *nameIndex)
+    {
+        QFileInfo inputFile(song);
+        *outFile = "";
+        *nameIndex = 0;
+        if (inputFile.absoluteFilePath().isEmpty())
+            return false;
+        const QChar separator = QLatin1Char(Profile::separator);
+        *outFile = musicRoot;
+        *outFile += separator;
+        if (preserveSongFolder) {
+            *outFile += inputFile.absoluteDir().dirName();
+            *outFile += separator;
+        }
+        *outFile += inputFile.fileName();
+        *nameIndex = (qint16)(outFile->size() - inputFile.fileName().size() + 1);
+        return true;
+    }
+};
+
+
+/** Length of a compile time string, usable in static_assert. */
+constexpr int plaTextLength(const char *text)
+{
+    return *text ? 1 + plaTextLength(text + 1) : 0;
+}
+
+/**
+ * \brief Encodes PLA header and song frames as described in plaPlayList documentation.
+ */
+template <class Profile>
+struct plaWriter
+{
+    static_assert(Profile::countBytes > 0 && Profile::countBytes <= 4 && Profile::countBytes <= Profile::magicOffset,
+                  "song count must fit before header magic");
+    static_assert(Profile::magicOffset + plaTextLength(Profile::magic()) <= Profile::frameSize,
+                  "header magic must fit into one frame");
+    static_assert(2 + 2 * (Profile::maxPathUnits + 1) <= Profile::frameSize,
+                  "name index, longest path and terminating null must fit into one frame");
+
+    /**
+     * @brief Header frame: song count followed by profile magic text, rest of the frame is 0.
+     */
+    static QByteArray header(qint32 songCount)
+    {
+        QByteArray frame(Profile::frameSize, '\0');
+        char *data = frame.data();
+        for (int i = 0; i < Profile::countBytes; i++)
+            data[i] = (char)(songCount >> (8 * (Profile::countBytes - 1 - i)));
+        const QByteArray magic(Profile::magic());
+        memcpy(data + Profile::magicOffset, magic.constData(), magic.size());
+        return frame;
+    }
+    /**
+     * @brief Appends one song frame: 16-bit name index followed by big-endian UTF-16 path, rest of the frame is 0
+     * (so path is always followed by at least one null unit).
+     * @param out Buffer to which frame is appended
+     * @param path Path as returned by plaPathMapper, must not exceed Profile::maxPathUnits
+     * @param nameIndex 1 based position in path from which the actual filename starts
+     */
+    static void appendSong(QByteArray *out, const QString &path, qint16 nameIndex)
+    {
+        const int offset = out->size();
+        out->resize(offset + Profile::frameSize);
+        char *data = out->data() + offset;
+        memset(data, 0, Profile::frameSize);
+        data[0] = (char)(nameIndex >> 8);
+        data[1] = (char)nameIndex;
+        const ushort *units = path.utf16();
+        const int count = qMin(path.size(), (int)Profile::maxPathUnits);
+        for (int i = 0; i < count; i++) {
+            data[2 + 2 * i] = (char)(units[i] >> 8);
+            data[3 + 2 * i] = (char)units[i];
+        }
+    }
+};
+
+
+/**
+ * \brief Compile time list of device profiles, run time profile selection is an index to this list.
+ *
+ * Code that depends on profile is written as a visitor, struct with result_type typedef and
+ * member template run<Profile>(), and called with plaProfiles::visit(index, visitor).
+ */
+template <class... Profiles>
+struct plaProfileList;
+
+template <>
+struct plaProfileList<>
+{
+    static const int count = 0;
+    static QStringList names() { return QStringList(); }
+    template <class Visitor>
+    static typename Visitor::result_type visit(int, Visitor &) { return typename Visitor::result_type(); }
+};
+
+template <class First, class... Rest>
+struct plaProfileList<First, Rest...>
+{
+    static const int count = 1 + sizeof...(Rest);
+    static QStringList names() { return QStringList(QString(First::name())) + plaProfileList<Rest...>::names(); }
+    static int indexOf(const QString &name) { return names().indexOf(name); }
+    template <class Visitor>
+    static typename Visitor::result_type visit(int index, Visitor &visitor)
+    {
+        if (index == 0)
+            return visitor.template run<First>();
+        return plaProfileList<Rest...>::visit(index - 1, visitor);
+    }
+};
+
+typedef plaProfileList<plaProfileT10, plaProfileT20, plaProfileT50, plaProfileH10> plaProfiles;
+
+#endif // PLAPROFILE_H
@@ -0,0 +1,242 @@
+#include "plasearchindex.h"
+#include <algorithm>
+
+static const int exactTermLength = 3;      /**< terms up to this length are grams, their lists need no verification */
+
+
+plaSearchIndex::plaSearchIndex(const plaPathStore *store) :
+    m_store(store)
+{
+    clear();
+}
+/**
+ * @brief Adds song to index, a song that is already in index is added again with its current path.
+ * @param id Song handle in the path store given to constructor
+ */
+void plaSearchIndex::add(plaPathStore::Handle id)
+{
+    if ((int)id >= m_entries.size()) {
+        m_entries.resize(id + 1);
+        m_present.resize(id + 1);
+    }
+    else if (m_present.testBit(id)) {
+        remove(id);
+    }
+    Entry &entry = m_entries[id];
+    entry.directory = m_store->directory(id);
+    entry.fileName = fold(m_store->fileName(id));
+    if (entry.directory != plaPathStore::noDirectory)
+        foldedDirectory(id);
+    m_present.setBit(id);
+    foreach (Gram g, grams(textOf(id))) {
+        QVector<quint32> &ids = m_postings[g];
+        // ids are normally added in increasing order, so this is an append
+        if (ids.isEmpty() || ids.last() < id)
+            ids.append(id);
+        else
+            ids.insert(std::lower_bound(ids.begin(), ids.end(), id), id);
+    }
+    invalidateHistory();
+}
+/**
+ * @brief Removes entry from index, unknown ids are ignored.
+ */
+void plaSearchIndex::remove(quint32 id)
+{
+    if ((int)id >= m_entries.size() || !m_present.testBit(id))
+        return;
+    foreach (Gram g, grams(textOf(id))) {
+        QHash<Gram, QVector<quint32> >::iterator it = m_postings.find(g);
+        if (it == m_postings.end())
+            continue;
+        QVector<quint32>::iterator pos = std::lower_bound(it->begin(), it->end(), id);
+        if (pos != it->end() && *pos == id)
+            it->erase(pos);
+        if (it->isEmpty())
+            m_postings.erase(it);
+    }
+    m_entries[id].fileName = QString();
+    m_present.clearBit(id);
+    invalidateHistory();
+}
+void plaSearchIndex::clear()
+{
+    m_entries.clear();
+    m_directories.clear();
+    m_directoryFolded.clear();
+    m_present.clear();
+    m_postings.clear();
+    invalidateHistory();
+}
+/**
+ * @brief Finds entries that contain all whitespace separated terms of the query, case insensitively.
+ * @param query Search text, empty query matches all entries
+ * @return Bit per id, set for matching entries
+ */
+QBitArray plaSearchIndex::match(const QString &query)
+{
+    QString folded = fold(query).simplified();
+    if (folded.isEmpty())
+        return m_present;
+    // drop previous queries that are not a prefix of this one (user erased or edited the query)
+    while (!m_history.isEmpty() && !folded.startsWith(m_history.last().first))
+        m_history.removeLast();
+    if (!m_history.isEmpty() && m_history.last().first == folded)
+        return toBits(m_history.last().second);
+    QStringList terms = folded.split(' ');
+    QVector<quint32> matching;
+    if (!m_history.isEmpty()) {
+        // query was refined, new matches are a subset of previous ones
+        const QVector<quint32> &previous = m_history.last().second;
+        matching.reserve(previous.size());
+        foreach (quint32 id, previous) {
+            if (matches(id, terms))
+                matching.append(id);
+        }
+    }
+    else {
+        QStringList longTerms;
+        foreach (const QString &term, terms) {
+            if (term.size() > exactTermLength)
+                longTerms.append(term);
+        }
+        QVector<quint32> ids = candidates(terms);
+        if (longTerms.isEmpty()) {
+            matching = ids;
+        }
+        else {
+            matching.reserve(ids.size());
+            foreach (quint32 id, ids) {
+                if (matches(id, longTerms))
+                    matching.append(id);
+            }
+        }
+    }
+    m_history.append(qMakePair(folded, matching));
+    return toBits(matching);
+}
+QBitArray plaSearchIndex::toBits(const QVector<quint32> &ids) const
+{
+    QBitArray retVal(m_entries.size());
+    foreach (quint32 id, ids)
+        retVal.setBit(id);
+    return retVal;
+}
+QString plaSearchIndex::textOf(quint32 id) const
+{
+    const Entry &entry = m_entries.at(id);
+    if (entry.directory == plaPathStore::noDirectory)
+        return entry.fileName;
+    return m_directories.at(entry.directory) + '/' + entry.fileName;
+}
+/**
+ * @brief Used to get folded text of the directory of a song, text is made from the store on first use.
+ */
+const QString &plaSearchIndex::foldedDirectory(quint32 id)
+{
+    plaPathStore::DirectoryId directory = m_entries.at(id).directory;
+    if ((int)directory >= m_directories.size()) {
+        m_directories.resize(directory + 1);
+        m_directoryFolded.resize(directory + 1);
+    }
+    if (!m_directoryFolded.testBit(directory)) {
+        m_directories[directory] = fold(m_store->directoryPath(id));
+        m_directoryFolded.setBit(directory);
+    }
+    return m_directories.at(directory);
+}
+QString plaSearchIndex::fold(const QString &text)
+{
+    return text.toCaseFolded();
+}
+plaSearchIndex::Gram plaSearchIndex::gram(const ushort *units, int count)
+{
+    Gram retVal = (Gram)count << 48;
+    for (int i = 0; i < count; i++)
+        retVal |= (Gram)units[i] << (16 * (count - 1 - i));
+    return retVal;
+}
+/**
+ * @brief Used to get distinct one, two and three character grams of text in ascending order.
+ */
+QVector<plaSearchIndex::Gram> plaSearchIndex::grams(const QString &text)
+{
+    QVector<Gram> retVal;
+    const ushort *units = text.utf16();
+    for (int count = 1; count <= exactTermLength; count++) {
+        for (int i = 0; i + count <= text.size(); i++)
+            retVal.append(gram(units + i, count));
+    }
+    std::sort(retVal.begin(), retVal.end());
+    retVal.erase(std::unique(retVal.begin(), retVal.end()), retVal.end());
+    return retVal;
+}
+/**
+ * @brief Used to get grams an entry must have to contain term: the term itself when it is short, otherwise its trigrams.
+ */
+QVector<plaSearchIndex::Gram> plaSearchIndex::termGrams(const QString &term)
+{
+    QVector<Gram> retVal;
+    const ushort *units = term.utf16();
+    if (term.size() <= exactTermLength) {
+        retVal.append(gram(units, term.size()));
+        return retVal;
+    }
+    for (int i = 0; i + exactTermLength <= term.size(); i++)
+        retVal.append(gram(units + i, exactTermLength));
+    std::sort(retVal.begin(), retVal.end());
+    retVal.erase(std::unique(retVal.begin(), retVal.end()), retVal.end());
+    return retVal;
+}
+/**
+ * @brief Used to get ids that have all grams of the terms.
+ */
+QVector<quint32> plaSearchIndex::candidates(const QStringList &terms) const
+{
+    QVector<const QVector<quint32> *> lists;
+    foreach (const QString &term, terms) {
+        foreach (Gram g, termGrams(term)) {
+            QHash<Gram, QVector<quint32> >::const_iterator it = m_postings.constFind(g);
+            if (it == m_postings.constEnd())
+                return QVector<quint32>();
+            lists.append(&it.value());
+        }
+    }
+    QVector<quint32> retVal;
+    int shortest = 0;
+    for (int i = 1; i < lists.count(); i++) {
+        if (lists.at(i)->size() < lists.at(shortest)->size())
+            shortest = i;
+    }
+    foreach (quint32 id, *lists.at(shortest)) {
+        bool inAll = true;
+        for (int i = 0; i < lists.count() && inAll; i++) {
+            if (i != shortest)
+                inAll = std::binary_search(lists.at(i)->begin(), lists.at(i)->end(), id);
+        }
+        if (inAll)
+            retVal.append(id);
+    }
+    return retVal;
+}
+/**
+ * Term is in text when it is in directory or file name part, or when it spans over the separator between them.
+ */
+bool plaSearchIndex::matches(quint32 id, const QStringList &terms) const
+{
+    const Entry &entry = m_entries.at(id);
+    foreach (const QString &term, terms) {
+        if (entry.fileName.contains(term))
+            continue;
+        if (entry.directory != plaPathStore::noDirectory && m_directories.at(entry.directory).contains(term))
+            continue;
+        if (entry.directory != plaPathStore::noDirectory && term.contains('/') && textOf(id).contains(term))
+            continue;
+        return false;
+    }
+    return true;
+}
+void plaSearchIndex::invalidateHistory()
+{
+    m_history.clear();
+}
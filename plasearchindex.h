@@ -0,0 +1,71 @@
+#ifndef PLASEARCHINDEX_H
+#define PLASEARCHINDEX_H
+
+#include <QBitArray>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "plapathstore.h"
+
+/**
+ * \brief plaSearchIndex is an n-gram index over playlist entry texts (file paths).
+ *
+ * Each entry is a plaPathStore handle and its text is the path in the store. Every one, two and three
+ * consecutive case folded characters of entry text are a gram, and index keeps a sorted id list per gram.
+ * Query is split to whitespace separated terms and entry matches when it contains all of them, in any order.
+ * A term of up to three characters is a gram itself and its list is the exact answer, a longer term needs all
+ * its trigrams. Candidates are taken from the shortest list of the query, intersected with the other lists
+ * and only candidates of terms longer than three characters are verified with string compare.
+ *
+ * Case folded texts are kept as directory + file name. Directories are referred to with plaPathStore directory
+ * ids and the folded text of a directory is made once, when the first song of that directory is added.
+ *
+ * Index is updated incrementally with add() and remove(). Matches of the queries typed so far are kept as a
+ * stack where each query is a prefix of the next: when user types, only the previous matches are checked, and
+ * when user erases, matches of the shorter query are taken from the stack.
+ */
+class plaSearchIndex
+{
+public:
+    explicit plaSearchIndex(const plaPathStore *store);
+
+    void add(plaPathStore::Handle id);
+    void remove(quint32 id);
+    void clear();
+
+    QBitArray match(const QString &query);
+
+private:
+    typedef quint64 Gram;                   /**< one to three UTF-16 units, their count in bits 48-49 */
+
+    /** Case folded text of one entry. */
+    struct Entry {
+        plaPathStore::DirectoryId directory;    /**< store directory id, plaPathStore::noDirectory when text has no directory part */
+        QString fileName;
+    };
+
+    const plaPathStore *m_store;
+    QVector<Entry> m_entries;               /**< by id, valid only for ids that are in index */
+    QVector<QString> m_directories;         /**< case folded directory texts by store directory id */
+    QBitArray m_directoryFolded;            /**< store directory ids whose text is in m_directories */
+    QBitArray m_present;                    /**< ids that are in index */
+    QHash<Gram, QVector<quint32> > m_postings;
+
+    /** Previous queries and their matches, each query is a prefix of the next one. Cleared when index changes. */
+    QVector<QPair<QString, QVector<quint32> > > m_history;
+
+    QString textOf(quint32 id) const;
+    const QString &foldedDirectory(quint32 id);
+    static QString fold(const QString &text);
+    static Gram gram(const ushort *units, int count);
+    static QVector<Gram> grams(const QString &text);
+    static QVector<Gram> termGrams(const QString &term);
+    QBitArray toBits(const QVector<quint32> &ids) const;
+    QVector<quint32> candidates(const QStringList &terms) const;
+    bool matches(quint32 id, const QStringList &terms) const;
+    void invalidateHistory();
+};
+
+#endif // PLASEARCHINDEX_H
@@ -0,0 +1,47 @@
+#include "plasearchproxy.h"
+#include "plaplaylistmodel.h"
+
+
+plaSearchProxy::plaSearchProxy(QObject *parent) :
+    QSortFilterProxyModel(parent),
+    m_model(0),
+    m_filtering(false)
+{
+}
+void plaSearchProxy::setPlaylistModel(plaPlaylistModel *model)
+{
+    m_model = model;
+    setSourceModel(model);
+    connect(model, SIGNAL(songsChanged()), this, SLOT(refresh()));
+}
+QString plaSearchProxy::searchText() const
+{
+    return m_searchText;
+}
+/**
+ * @brief Filters view to rows that contain all whitespace separated words of text, empty text shows all rows.
+ */
+void plaSearchProxy::setSearchText(QString text)
+{
+    m_searchText = text;
+    m_filtering = !text.trimmed().isEmpty();
+    refresh();
+}
+void plaSearchProxy::refresh()
+{
+    if (!m_model)
+        return;
+    if (!m_filtering)
+        m_matches.clear();
+    else
+        m_matches = m_model->searchIndex()->match(m_searchText);
+    invalidateFilter();
+}
+bool plaSearchProxy::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    Q_UNUSED(sourceParent);
+    if (!m_model || !m_filtering)
+        return true;
+    quint32 id = m_model->handleAt(sourceRow);
+    return (int)id < m_matches.size() && m_matches.testBit(id);
+}
@@ -0,0 +1,41 @@
+#ifndef PLASEARCHPROXY_H
+#define PLASEARCHPROXY_H
+
+#include <QBitArray>
+#include <QSortFilterProxyModel>
+
+class plaPlaylistModel;
+
+/**
+ * \brief plaSearchProxy filters playlist view with search text.
+ *
+ * Matching is done with the search index of plaPlaylistModel, proxy only checks one bit per row.
+ * Matches are refreshed once per change of the songs in source model (plaPlaylistModel::songsChanged()),
+ * not per inserted or removed row range.
+ */
+class plaSearchProxy : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    explicit plaSearchProxy(QObject *parent = 0);
+
+    void setPlaylistModel(plaPlaylistModel *model);
+    QString searchText() const;
+
+public slots:
+    void setSearchText(QString text);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+
+private slots:
+    void refresh();
+
+private:
+    plaPlaylistModel *m_model;
+    QString m_searchText;
+    bool m_filtering;           /**< false when search text is empty, all rows are shown */
+    QBitArray m_matches;
+};
+
+#endif // PLASEARCHPROXY_H
@@ -0,0 +1,242 @@
+#include "plasession.h"
+#include "plafile.h"
+#include <QByteArray>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QtEndian>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+#include <cstring>
+
+static const char sessionMagic[8] = { 'I', 'R', 'P', 'L', 'A', 'S', 'E', 'S' };
+static const quint32 sessionVersion = 5;
+static const int headerSize = 24;
+static const int recordSize = 40;
+static const quint32 recordKnown = 0x01;   /**< record flag, metadata was known when snapshot was saved */
+
+
+plaSession::plaSession() :
+    m_data(0),
+    m_size(0),
+    m_infoOffset(0),
+    m_infoCount(0)
+{
+}
+plaSession::~plaSession()
+{
+    close();
+}
+/**
+ * @brief Used to get the location of session snapshot in user's application data folder.
+ */
+QString plaSession::defaultFileName()
+{
+#if QT_VERSION >= 0x050000
+    QString location = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+#else
+    QString location = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+#endif
+    return location + "/session.plas";
+}
+/**
+ * @brief Writes snapshot of playlist. Snapshot is built in memory first and the file is replaced only after that,
+ * so a session that is attached to playList (and possibly maps the same file) stays valid while data is gathered.
+ * @return true if snapshot was written, false otherwise
+ */
+bool plaSession::save(const QString &fileName, plaPlayList *playList)
+{
+    QByteArray data(headerSize, '\0');
+    QDataStream out(&data, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(QDataStream::Qt_4_8);
+    out << playList->musicFileDestination << playList->playlistDestination << playList->playlistName
+        << playList->preserveSongFolder << (qint32)playList->deviceProfile;
+    // removed songs are left out, snapshot has only playlist songs, their canonical paths and their directories
+    QVector<plaPathStore::Handle> songs = playList->handles();
+    QVector<plaPathStore::Handle> kept = songs;
+    plaSongInfo info;
+    foreach (plaPathStore::Handle handle, songs) {
+        if (playList->cachedSongInfo(handle, &info) && info.canonical != handle)
+            kept.append(info.canonical);
+    }
+    QVector<plaPathStore::Handle> renumbered, original;
+    plaPathStore paths = playList->pathStore()->compacted(kept, &renumbered, &original);
+    QHash<plaPathStore::Handle, plaPathStore::Handle> copyOf;
+    for (int i = 0; i < kept.count(); i++)
+        copyOf.insert(kept.at(i), renumbered.at(i));
+    paths.save(out);
+    out << (quint32)songs.count();
+    for (int i = 0; i < songs.count(); i++)
+        out << renumbered.at(i);
+    QHash<plaPathStore::Handle, plaPathStore::Handle> duplicates = playList->duplicates();
+    out << (quint32)duplicates.count();
+    QHash<plaPathStore::Handle, plaPathStore::Handle>::const_iterator duplicate = duplicates.constBegin();
+    for (; duplicate != duplicates.constEnd(); ++duplicate)
+        out << copyOf.value(duplicate.key()) << copyOf.value(duplicate.value());
+
+    // metadata records are aligned to 8 bytes
+    data.append(QByteArray((8 - data.size() % 8) % 8, '\0'));
+    const quint32 infoOffset = data.size();
+    const quint32 infoCount = paths.count();
+    data.append(QByteArray(infoCount * recordSize, '\0'));
+    uchar *record = (uchar *)data.data() + infoOffset;
+    for (quint32 handle = 0; handle < infoCount; handle++, record += recordSize) {
+        if (!playList->cachedSongInfo(original.at(handle), &info))
+            continue;
+        qToLittleEndian<qint64>(info.size, record);
+        qToLittleEndian<qint64>(info.modified, record + 8);
+        qToLittleEndian<quint64>(info.device, record + 16);
+        qToLittleEndian<quint64>(info.inode, record + 24);
+        qToLittleEndian<quint32>(copyOf.value(info.canonical, handle), record + 32);
+        qToLittleEndian<quint32>(recordKnown, record + 36);
+    }
+
+    uchar *header = (uchar *)data.data();
+    memcpy(header, sessionMagic, sizeof(sessionMagic));
+    qToLittleEndian<quint32>(sessionVersion, header + 8);
+    qToLittleEndian<quint32>(infoOffset, header + 12);
+    qToLittleEndian<quint32>(infoCount, header + 16);
+
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QString tmpName = fileName + ".tmp";
+    QFile file(tmpName);
+    if (!file.open(QIODevice::Truncate | QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        qDebug() << "plaSession::save - writing " << tmpName << " failed: " << file.errorString();
+        file.remove();
+        return false;
+    }
+    file.close();
+    // mapped snapshot may be the one that is replaced, release it. New snapshot is not attached as its
+    // handles are renumbered, metadata of playlist songs was decoded above and stays cached in playList.
+    playList->releaseSession();
+    QFile::remove(fileName);
+    if (!QFile::rename(tmpName, fileName)) {
+        qDebug() << "plaSession::save - replacing " << fileName << " failed";
+        return false;
+    }
+    return true;
+}
+/**
+ * @brief Maps snapshot file to memory and validates its header, nothing is decoded yet.
+ * @return true if file is a valid snapshot, false otherwise
+ */
+bool plaSession::open(const QString &fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+    m_size = m_file.size();
+    if (m_size < headerSize) {
+        close();
+        return false;
+    }
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        close();
+        return false;
+    }
+    if (memcmp(m_data, sessionMagic, sizeof(sessionMagic)) != 0
+     || qFromLittleEndian<quint32>(m_data + 8) != sessionVersion) {
+        qDebug() << "plaSession::open - " << fileName << " is not a known session snapshot";
+        close();
+        return false;
+    }
+    m_infoOffset = qFromLittleEndian<quint32>(m_data + 12);
+    m_infoCount = qFromLittleEndian<quint32>(m_data + 16);
+    if (m_infoOffset < (quint32)headerSize || (qint64)m_infoOffset + (qint64)m_infoCount * recordSize > m_size) {
+        close();
+        return false;
+    }
+    return true;
+}
+/**
+ * @brief Restores settings, paths and playlist order to playList and attaches this session to it for
+ * metadata lookups, playlist takes ownership of the session when restore succeeds.
+ * @return true if snapshot was restored, false otherwise (playList is not changed)
+ */
+bool plaSession::restore(plaPlayList *playList)
+{
+    if (!m_data)
+        return false;
+    QByteArray data = QByteArray::fromRawData((const char *)m_data + headerSize, m_infoOffset - headerSize);
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_4_8);
+    QString musicFileDestination, playlistDestination, playlistName;
+    bool preserveSongFolder = true;
+    qint32 deviceProfile = 0;
+    in >> musicFileDestination >> playlistDestination >> playlistName >> preserveSongFolder >> deviceProfile;
+    plaPathStore paths;
+    if (in.status() != QDataStream::Ok || !paths.load(in))
+        return false;
+    quint32 count = 0;
+    in >> count;
+    QVector<plaPathStore::Handle> handles;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        plaPathStore::Handle handle;
+        in >> handle;
+        if ((int)handle >= paths.count())
+            return false;
+        handles.append(handle);
+    }
+    quint32 duplicateCount = 0;
+    in >> duplicateCount;
+    QHash<plaPathStore::Handle, plaPathStore::Handle> duplicates;
+    for (quint32 i = 0; i < duplicateCount && in.status() == QDataStream::Ok; i++) {
+        plaPathStore::Handle duplicate, original;
+        in >> duplicate >> original;
+        if ((int)duplicate >= paths.count() || (int)original >= paths.count())
+            return false;
+        duplicates.insert(duplicate, original);
+    }
+    if (in.status() != QDataStream::Ok || handles.count() != (int)count || duplicates.count() != (int)duplicateCount
+     || (int)m_infoCount != paths.count())
+        return false;
+
+    playList->musicFileDestination = musicFileDestination;
+    playList->playlistDestination = playlistDestination;
+    playList->playlistName = playlistName;
+    playList->preserveSongFolder = preserveSongFolder;
+    if (deviceProfile >= 0 && deviceProfile < plaProfiles::count)
+        playList->deviceProfile = deviceProfile;
+    *playList->pathStore() = paths;
+    playList->setHandles(handles);
+    playList->setDuplicates(duplicates);
+    playList->setSession(this);
+    return true;
+}
+/**
+ * @brief Decodes metadata record of one song from mapped snapshot.
+ * @return true if metadata of the song was in snapshot, false otherwise
+ */
+bool plaSession::songInfo(plaPathStore::Handle handle, plaSongInfo *info) const
+{
+    if (!m_data || handle >= m_infoCount)
+        return false;
+    const uchar *record = m_data + m_infoOffset + (qint64)handle * recordSize;
+    if (!(qFromLittleEndian<quint32>(record + 36) & recordKnown))
+        return false;
+    info->size = qFromLittleEndian<qint64>(record);
+    info->modified = qFromLittleEndian<qint64>(record + 8);
+    info->device = qFromLittleEndian<quint64>(record + 16);
+    info->inode = qFromLittleEndian<quint64>(record + 24);
+    info->canonical = qFromLittleEndian<quint32>(record + 32);
+    if (info->canonical >= m_infoCount)
+        info->canonical = handle;
+    return true;
+}
+void plaSession::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar *>(m_data));
+    m_file.close();
+    m_data = 0;
+    m_size = 0;
+    m_infoOffset = 0;
+    m_infoCount = 0;
+}
@@ -0,0 +1,54 @@
+#ifndef PLASESSION_H
+#define PLASESSION_H
+
+#include <QFile>
+#include <QString>
+#include "plapathstore.h"
+
+class plaPlayList;
+struct plaSongInfo;
+
+/**
+ * \brief plaSession saves the working set of the program as a compact binary snapshot and restores it at startup.
+ *
+ * Snapshot contains settings (destinations, playlist name, preserveSongFolder, player model), the path store,
+ * playlist order and cached song metadata (size, modification time and file identity used by plaDuplicateDetector).
+ *
+ * Snapshot file layout, integers are little-endian:
+ * \li header (24 bytes): 'IRPLASES', version, offset of metadata records, number of metadata records, 0
+ * \li QDataStream part: settings, plaPathStore::save() data, playlist order as handles, duplicate and original handle pairs
+ * \li metadata records (40 bytes each, one per path store handle): size, modified, device, inode, canonical path handle, flags
+ *
+ * Path store is compacted when saved: only playlist songs, their canonical paths and directories are written, with handles
+ * renumbered, so snapshot does not grow with songs that were removed during earlier sessions.
+ *
+ * Snapshot is memory mapped when opened, but only the metadata records are restored lazily: they are left in the
+ * mapped file and decoded when plaPlayList asks for them. Settings, the whole path store, playlist order and duplicate
+ * pairs are decoded with QDataStream in restore(), so startup time still grows with the number of songs.
+ * Restored metadata is not trusted as such either, plaPlayList::verifiedSongInfo() stats the file on every call and
+ * the snapshot only saves the canonical path lookup (and the file identity needed for duplicate checks) of unchanged songs.
+ */
+class plaSession
+{
+public:
+    plaSession();
+    ~plaSession();
+
+    static QString defaultFileName();
+    static bool save(const QString &fileName, plaPlayList *playList);
+
+    bool open(const QString &fileName);
+    bool restore(plaPlayList *playList);
+    bool songInfo(plaPathStore::Handle handle, plaSongInfo *info) const;
+
+private:
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    quint32 m_infoOffset;
+    quint32 m_infoCount;
+
+    void close();
+};
+
+#endif // PLASESSION_H
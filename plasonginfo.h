@@ -0,0 +1,18 @@
+#ifndef PLASONGINFO_H
+#define PLASONGINFO_H
+
+#include "plapathstore.h"
+
+/**
+ * File metadata of one song, gathered once and cached (also over sessions, see plaSession).
+ * Cached metadata may be stale, plaPlayList::verifiedSongInfo() compares it with the file before it is trusted.
+ */
+struct plaSongInfo {
+    qint64 size;                    /**< file size in bytes */
+    qint64 modified;                /**< last modification time, milliseconds since epoch */
+    quint64 device;                 /**< device and inode of the file, 0 when not available on this platform */
+    quint64 inode;
+    plaPathStore::Handle canonical; /**< handle of canonical path (symlinks resolved), song itself if path is canonical */
+};
+
+#endif // PLASONGINFO_H
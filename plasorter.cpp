@@ -0,0 +1,287 @@
+#include "plasorter.h"
+#include <QThread>
+#include <QtConcurrentMap>
+#include <algorithm>
+#include <vector>
+#if QT_VERSION >= 0x050200
+#include <QCollator>
+#endif
+
+namespace {
+
+#if QT_VERSION >= 0x050200
+typedef QCollatorSortKey SortKey;
+#else
+typedef QString SortKey;
+#endif
+
+/** Precomputed sort keys of one song. */
+struct Record {
+    QList<SortKey> keys;
+};
+
+/** Part of records handled by one thread, middle is used when two sorted parts are merged. */
+struct Range {
+    int begin;
+    int middle;
+    int end;
+    int digits;     /**< longest digit run in keys of the range, used only when keys are padded */
+};
+
+const int minimumChunk = 2048;     /**< smaller inputs are not split between threads */
+
+QString keyText(const plaPathStore *store, plaPathStore::Handle handle, plaSorter::Key key)
+{
+    if (key == plaSorter::KeyFolder)
+        return store->directoryPath(handle);
+    if (key == plaSorter::KeyFileName)
+        return store->fileName(handle);
+    return store->path(handle);
+}
+
+#if QT_VERSION >= 0x050200
+/**
+ * Collation backends without ICU (POSIX) do not support numeric mode nor case insensitivity, they only
+ * print a warning. Then keys are padded and case folded as with Qt older than 5.2.
+ */
+bool collatorIsNatural()
+{
+    QCollator collator;
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    collator.setNumericMode(true);
+    return collator.compare(QString("2"), QString("10")) < 0 && collator.compare(QString("a"), QString("A")) == 0;
+}
+#endif
+
+int longestDigitRun(const QString &text)
+{
+    int retVal = 0;
+    int run = 0;
+    for (int i = 0; i < text.size(); i++) {
+        run = text.at(i).isDigit() ? run + 1 : 0;
+        retVal = qMax(retVal, run);
+    }
+    return retVal;
+}
+/**
+ * Numbers in text are zero padded to given width so that plain text compare orders them by value.
+ */
+QString naturalText(const QString &text, int width)
+{
+    QString retVal;
+    retVal.reserve(text.size() + width);
+    int i = 0;
+    while (i < text.size()) {
+        if (!text.at(i).isDigit()) {
+            retVal += text.at(i++);
+            continue;
+        }
+        int end = i;
+        while (end < text.size() && text.at(end).isDigit())
+            end++;
+        while (i < end - 1 && text.at(i) == QLatin1Char('0'))
+            i++;
+        for (int pad = end - i; pad < width; pad++)
+            retVal += QLatin1Char('0');
+        retVal += text.mid(i, end - i);
+        i = end;
+    }
+    return retVal;
+}
+
+int compareKeys(const SortKey &a, const SortKey &b)
+{
+#if QT_VERSION >= 0x050200
+    return a.compare(b);
+#else
+    return QString::localeAwareCompare(a, b);
+#endif
+}
+
+/** Finds the longest digit run in key texts of a range of songs. */
+struct DigitCounter {
+    typedef void result_type;
+    const plaPathStore *store;
+    const QVector<plaPathStore::Handle> *handles;
+    const QList<plaSorter::Key> *keys;
+
+    void operator()(Range &range) const
+    {
+        range.digits = 0;
+        for (int i = range.begin; i < range.end; i++) {
+            foreach (plaSorter::Key key, *keys)
+                range.digits = qMax(range.digits, longestDigitRun(keyText(store, handles->at(i), key)));
+        }
+    }
+};
+
+/** Computes sort keys of a range of songs, each thread uses its own collator. */
+struct KeyBuilder {
+    typedef void result_type;
+    const plaPathStore *store;
+    const QVector<plaPathStore::Handle> *handles;
+    const QList<plaSorter::Key> *keys;
+    std::vector<Record> *records;
+    bool natural;   /**< collator compares numbers by value and ignores case, otherwise keys are padded and folded here */
+    int digits;     /**< width digit runs are padded to when keys are padded */
+
+    void operator()(const Range &range) const
+    {
+#if QT_VERSION >= 0x050200
+        QCollator collator;
+        if (natural) {
+            collator.setCaseSensitivity(Qt::CaseInsensitive);
+            collator.setNumericMode(true);
+        }
+#endif
+        for (int i = range.begin; i < range.end; i++) {
+            plaPathStore::Handle handle = handles->at(i);
+            Record &record = (*records)[i];
+            foreach (plaSorter::Key key, *keys) {
+                QString text = keyText(store, handle, key);
+                if (!natural)
+                    text = naturalText(text.toCaseFolded(), digits);
+#if QT_VERSION >= 0x050200
+                record.keys.append(collator.sortKey(text));
+#else
+                record.keys.append(text);
+#endif
+            }
+        }
+    }
+};
+
+struct RecordLessThan {
+    const std::vector<Record> *records;
+
+    bool operator()(int a, int b) const
+    {
+        const QList<SortKey> &keysA = (*records)[a].keys;
+        const QList<SortKey> &keysB = (*records)[b].keys;
+        for (int i = 0; i < keysA.count(); i++) {
+            int result = compareKeys(keysA.at(i), keysB.at(i));
+            if (result != 0)
+                return result < 0;
+        }
+        return false;
+    }
+};
+
+struct RangeSorter {
+    typedef void result_type;
+    std::vector<int> *order;
+    RecordLessThan lessThan;
+
+    void operator()(const Range &range) const
+    {
+        std::stable_sort(order->begin() + range.begin, order->begin() + range.end, lessThan);
+    }
+};
+
+struct RangeMerger {
+    typedef void result_type;
+    std::vector<int> *order;
+    RecordLessThan lessThan;
+
+    void operator()(const Range &range) const
+    {
+        if (range.middle < range.end)
+            std::inplace_merge(order->begin() + range.begin, order->begin() + range.middle, order->begin() + range.end, lessThan);
+    }
+};
+
+/**
+ * QVector::fromStdVector is deprecated and iterator range constructor of QVector is not in Qt 4, copy by hand.
+ */
+QVector<int> toVector(const std::vector<int> &order)
+{
+    QVector<int> retVal(int(order.size()));
+    std::copy(order.begin(), order.end(), retVal.begin());
+    return retVal;
+}
+
+} // namespace
+
+
+plaSorter::plaSorter(const plaPathStore *store) :
+    m_store(store)
+{
+}
+/**
+ * @brief Sorts songs by given keys, first key is the primary one.
+ * @param handles Songs in current order
+ * @param keys Sort keys in priority order
+ * @return New order given as current row numbers, suitable for plaPlaylistModel::reorder()
+ */
+QVector<int> plaSorter::sort(const QVector<plaPathStore::Handle> &handles, const QList<Key> &keys) const
+{
+    const int count = handles.count();
+    std::vector<int> order(count);
+    for (int i = 0; i < count; i++)
+        order[i] = i;
+    if (count < 2 || keys.isEmpty())
+        return toVector(order);
+
+    // split to one range per thread
+    int chunks = qBound(1, count / minimumChunk, qMax(1, QThread::idealThreadCount()));
+    int chunkSize = (count + chunks - 1) / chunks;
+    QList<Range> ranges;
+    for (int begin = 0; begin < count; begin += chunkSize) {
+        Range range;
+        range.begin = begin;
+        range.end = qMin(count, begin + chunkSize);
+        range.middle = range.end;
+        range.digits = 0;
+        ranges.append(range);
+    }
+
+    // precompute keys
+    std::vector<Record> records(count);
+    KeyBuilder builder;
+    builder.store = m_store;
+    builder.handles = &handles;
+    builder.keys = &keys;
+    builder.records = &records;
+#if QT_VERSION >= 0x050200
+    static const bool collatorNatural = collatorIsNatural();
+    builder.natural = collatorNatural;
+#else
+    builder.natural = false;
+#endif
+    builder.digits = 0;
+    if (!builder.natural) {
+        // numbers are not known by the comparison, pad them all to the width of the longest one
+        DigitCounter counter;
+        counter.store = m_store;
+        counter.handles = &handles;
+        counter.keys = &keys;
+        QtConcurrent::blockingMap(ranges, counter);
+        foreach (const Range &range, ranges)
+            builder.digits = qMax(builder.digits, range.digits);
+    }
+    QtConcurrent::blockingMap(ranges, builder);
+
+    // sort ranges, then merge neighbours until one range is left
+    RecordLessThan lessThan;
+    lessThan.records = &records;
+    RangeSorter sorter;
+    sorter.order = &order;
+    sorter.lessThan = lessThan;
+    QtConcurrent::blockingMap(ranges, sorter);
+    RangeMerger merger;
+    merger.order = &order;
+    merger.lessThan = lessThan;
+    while (ranges.count() > 1) {
+        QList<Range> merged;
+        for (int i = 0; i < ranges.count(); i += 2) {
+            Range range = ranges.at(i);
+            range.middle = range.end;
+            if (i + 1 < ranges.count())
+                range.end = ranges.at(i + 1).end;
+            merged.append(range);
+        }
+        QtConcurrent::blockingMap(merged, merger);
+        ranges = merged;
+    }
+    return toVector(order);
+}
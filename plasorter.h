@@ -0,0 +1,39 @@
+#ifndef PLASORTER_H
+#define PLASORTER_H
+
+#include <QList>
+#include <QVector>
+#include "plapathstore.h"
+
+/**
+ * \brief plaSorter orders playlist songs by several keys at once.
+ *
+ * Sort keys are precomputed once per song before sorting: locale aware collation keys in numeric mode,
+ * so that 'Track 2' comes before 'Track 10'. Before Qt 5.2 there is no QCollator, and collators without ICU
+ * ignore numeric mode and case insensitivity; then keys are case folded texts where digit runs are zero padded
+ * to the length of the longest run in all keys.
+ * Songs are then sorted with a parallel stable sort, songs with equal keys keep their current order.
+ * Result is the new order of rows, to be applied to plaPlaylistModel with one reorder() call.
+ *
+ * Keys are taken from paths as song tags are not read by this program: folder usually is 'artist/album'
+ * and file name usually starts with track number.
+ */
+class plaSorter
+{
+public:
+    /** Parts of song path that can be used as sort keys. */
+    enum Key {
+        KeyFolder,      /**< directory path of the song */
+        KeyFileName,    /**< file name of the song */
+        KeyPath         /**< full path of the song */
+    };
+
+    explicit plaSorter(const plaPathStore *store);
+
+    QVector<int> sort(const QVector<plaPathStore::Handle> &handles, const QList<Key> &keys) const;
+
+private:
+    const plaPathStore *m_store;
+};
+
+#endif // PLASORTER_H